@@ -0,0 +1,104 @@
+/*
+    alias.c
+*/
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "alias.h"
+
+int alias_init (salias * A, const double * weights, unsigned n)
+{
+    double * p, sum;
+    unsigned * work, numsmall, numlarge, i, s, l;
+
+    A->n = n;
+    A->prob = (unsigned*) malloc (n*sizeof(unsigned));
+    A->alias = (unsigned*) malloc (n*sizeof(unsigned));
+    p = (double*) malloc (n*sizeof(double));
+    work = (unsigned*) malloc (n*sizeof(unsigned));
+
+    if (!A->prob || !A->alias || !p || !work)
+    {
+        alias_free (A);
+        free (p);
+        free (work);
+        return -1;
+    }
+
+    for (sum=0, i=0; i<n; i++)
+        sum += weights[i];
+
+    // Scale the weights to a mean of 1, and split the columns:
+    // those under 1 (small) from the start of 'work', and the
+    // rest (large) from the end
+    for (numsmall=numlarge=0, i=0; i<n; i++)
+    {
+        p[i] = weights[i] * n / sum;
+
+        if (p[i]<1)
+            work[numsmall++] = i;
+        else
+            work[n-1-numlarge++] = i;
+    }
+
+    // Fill each small column with a piece of a large one
+    while (numsmall && numlarge)
+    {
+        s = work[--numsmall];
+        l = work[n-numlarge];
+
+        A->prob[s] = (unsigned) (p[s] * 4294967296.0);
+        A->alias[s] = l;
+        p[l] -= 1 - p[s];
+
+        if (p[l]<1)
+        {
+            numlarge --;
+            work[numsmall++] = l;
+        }
+    }
+
+    // The rest are full (or nearly, by rounding)
+    while (numsmall)
+    {
+        s = work[--numsmall];
+        A->prob[s] = ~0U;
+        A->alias[s] = s;
+    }
+
+    while (numlarge)
+    {
+        l = work[n-numlarge--];
+        A->prob[l] = ~0U;
+        A->alias[l] = l;
+    }
+
+    free (p);
+    free (work);
+    return 0;
+}
+
+void alias_free (salias * A)
+{
+    free (A->prob);
+    free (A->alias);
+
+    A->prob = A->alias = NULL;
+}
+
+unsigned alias_draw (const salias * A, unsigned long long r)
+{
+    // The upper bits choose the column, the lower ones compare
+    unsigned i = (unsigned) (((r>>32) * A->n) >> 32);
+
+    return (unsigned) r < A->prob[i] ? i : A->alias[i];
+}
+
+void zipf_weights (double * weights, unsigned n, double alpha)
+{
+    unsigned i;
+
+    for (i=0; i<n; i++)
+        weights[i] = alpha ? pow (i+1, -alpha) : 1;
+}
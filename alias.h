@@ -0,0 +1,37 @@
+/*
+    alias.h
+*/
+
+#ifndef _ALIAS_H_
+#define _ALIAS_H_
+
+// Alias tables (Walker, with Vose's construction), to draw
+// numbers 0..n-1 with any given weights in O(1): a random
+// column is chosen, and then either the column itself or its
+// alias, after a single comparison. Building the table takes
+// O(n).
+
+typedef struct
+{
+    unsigned n;         // Numbers
+    unsigned * prob;    // Threshold of each column (of 2^32)
+    unsigned * alias;   // Alias of each column
+}
+salias;
+
+// Build the table for the given weights (not all 0). Return 0
+// if OK, -1 if there is not enough memory.
+
+int alias_init (salias * A, const double * weights, unsigned n);
+void alias_free (salias * A);
+
+// Draw a number, from 64 random bits
+
+unsigned alias_draw (const salias * A, unsigned long long r);
+
+// Weights of a Zipf distribution: that of i is 1/(i+1)^alpha
+// (alpha 0 = uniform)
+
+void zipf_weights (double * weights, unsigned n, double alpha);
+
+#endif // _ALIAS_H_
@@ -0,0 +1,567 @@
+/*
+    analyze_locality.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "trace.h"
+#include "trace_cache.h"
+#include "stack_dist.h"
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagesz;
+    const char * algorithm, * initialorder;
+    int numelem;
+    const char * tracefile;   // Trace file (NULL = run gen_trace)
+    unsigned seed;            // Seed for gen_trace
+    const char * outputs;     // Outputs to print (see below)
+}
+sparameters;
+
+// Outputs of the analysis, selected with -o
+
+#define OUT_REUSE   'r'    // Reuse (stack) distances
+#define OUT_GAPS    'g'    // Inter-reference gaps
+#define OUT_FREQ    'f'    // Page frequencies and Zipf fit
+#define OUT_RUNS    's'    // Sequential runs
+#define ALL_OUTPUTS "rgfs"
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Histograms with logarithmic bins: bin b holds the values
+// from 2^b to 2^(b+1)-1
+
+#define NUM_BINS 64
+
+typedef struct
+{
+    unsigned long long count[NUM_BINS];  // Events per bin
+    unsigned long long weight[NUM_BINS]; // Their weight
+}
+shistogram;
+
+void histogram_add (shistogram *, unsigned long long value,
+                    unsigned long long weight);
+void print_histogram (const shistogram *, const char * title,
+                      const char * what, const char * weight);
+
+// State of the analysis
+
+typedef struct
+{
+    unsigned numpages;             // # of pages
+    unsigned long long numrefs;    // # of references (time)
+    unsigned long long numillegal; // References out of range
+
+    // Reuse distances, with the LRU stack of the pages
+    sstack K;
+    shistogram reuse;
+    unsigned long long numcold;    // First references
+
+    // Gaps, with the time of the last reference of each page
+    unsigned long long * lasttime;
+    shistogram gaps;
+
+    // Frequencies
+    unsigned long long * numpagerefs;
+
+    // Sequential runs: consecutive pages in one direction
+    unsigned lastpage;             // Last page referenced
+    int direction;                 // +1, -1 or 0 (not known)
+    unsigned long long runlength;  // Pages of the current run
+    shistogram runs;
+}
+slocality;
+
+int reserve_locality (slocality *, unsigned numpages);
+void free_locality (slocality *);
+
+void annotate_reference (slocality *, unsigned page);
+void end_runs (slocality *);
+
+void print_frequencies (const slocality *);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    char source[FILENAME_MAX];  // Cached trace (or command)
+    strace T;           // Trace being read
+    int ok, hit;        // Flags
+    char op;            // Elementary operation ('R'ead, 'W'ri..)
+    unsigned u;         // Number of the read/written element
+    unsigned numpags;   // Total number of pages
+    slocality L;        // State of the analysis
+
+    L.lasttime = NULL;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    if (P.tracefile)
+    {
+        printf ("# Parameters:  %s %i\n", argv[0], P.pagesz);
+
+        printf ("# Reading trace:  %s\n", P.tracefile);
+
+        // Map the file in memory and read the total # of
+        // elements
+        if (trace_open_file(&T,P.tracefile)<0)
+        {
+            perror ("ERROR while opening the trace");
+            return -1;
+        }
+    }
+    else
+    {
+        printf ("# Parameters:  %s %i %s %s %i\n",
+                argv[0], P.pagesz,
+                P.algorithm, P.initialorder, P.numelem);
+
+        // Take the trace from the cache, or generate it by
+        // invoking gen_trace
+        hit = trace_cache_open (&T, P.algorithm, P.initialorder,
+                                P.numelem, P.seed,
+                                source, sizeof(source));
+
+        if (hit<0)
+        {
+            perror ("ERROR while starting gen_trace");
+            return -1;
+        }
+
+        printf ("# Trace:  %s (%s)\n", source,
+                hit ? "cached" : "generated");
+    }
+
+    ok = T.totelem > 0;
+
+    if (ok)
+    {
+        // Calculate total number of pages
+        numpags = (T.totelem+P.pagesz-1) / P.pagesz;
+
+        if (reserve_locality(&L,numpags)<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+    }
+
+    while (ok)
+    {
+        // Read one operation (and the element, if R/W)
+        if (trace_next(&T,&op,&u)!=1)
+        {
+            ok = 0;
+            break;
+        }
+
+        if (op=='R' || op=='W')                  // If R/W,
+            annotate_reference (&L, u/P.pagesz); // annotate
+        else if (op=='S')        // 'S'orted -> end
+            break;               // 'C'omparison -> go on
+        else if (op!='C')        // 'O'ut of order (or
+            ok = 0;              // something else) -> error
+    }
+
+    if (ok)
+    {
+        end_runs (&L);
+
+        printf ("# References:  %llu\n",
+                L.numrefs - L.numillegal);
+
+        if (strchr(P.outputs,OUT_REUSE))
+        {
+            print_histogram (&L.reuse, "Reuse distances",
+                             "Distance", "References");
+            printf ("# First references:  %llu\n", L.numcold);
+        }
+
+        if (strchr(P.outputs,OUT_GAPS))
+            print_histogram (&L.gaps, "Inter-reference gaps",
+                             "Gap", "References");
+
+        if (strchr(P.outputs,OUT_FREQ))
+            print_frequencies (&L);
+
+        if (strchr(P.outputs,OUT_RUNS))
+            print_histogram (&L.runs, "Sequential runs",
+                             "Pages", "Pages");
+
+        if (L.numillegal)
+            printf ("WARNING: There were %llu references to "
+                             "nonexistent pages\n", L.numillegal);
+    }
+
+    // Wait until gen_trace ends and close
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    free_locality (&L);
+
+    return ok ? 0 : -1;
+}
+
+// Functions of the histograms
+
+void histogram_add (shistogram * H, unsigned long long value,
+                    unsigned long long weight)
+{
+    int b;
+
+    for (b=0; value>1; b++)
+        value >>= 1;
+
+    H->count[b] ++;
+    H->weight[b] += weight;
+}
+
+void print_histogram (const shistogram * H, const char * title,
+                      const char * what, const char * weight)
+{
+    unsigned long long total, sum;
+    int b, last;
+
+    for (b=last=0, total=0; b<NUM_BINS; b++)
+        if (H->count[b])
+        {
+            last = b;
+            total += H->weight[b];
+        }
+
+    printf ("#\n# %s\n#\n#%14s %15s %15s %15s %15s\n#\n",
+            title, what, "(up to)", "Count", weight,
+            "Cumulative");
+
+    // The cumulative fraction is that of the weights
+    for (b=0, sum=0; b<=last; b++)
+    {
+        sum += H->weight[b];
+
+        printf (" %14llu %15llu %15llu %15llu %15f\n",
+                1ULL<<b, (2ULL<<b)-1, H->count[b], H->weight[b],
+                total ? sum / (double) total : 0);
+    }
+}
+
+// Functions that manipulate the state of the analysis
+
+int reserve_locality (slocality * L, unsigned numpages)
+{
+    memset (L, 0, sizeof(*L));
+
+    L->numpages = numpages;
+    L->lasttime = (unsigned long long*)
+                  calloc (numpages, sizeof(unsigned long long));
+    L->numpagerefs = (unsigned long long*)
+                     calloc (numpages, sizeof(unsigned long long));
+
+    if (!L->lasttime || !L->numpagerefs ||
+        stack_init(&L->K,numpages)<0)
+    {
+        free (L->lasttime);
+        free (L->numpagerefs);
+        L->lasttime = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void free_locality (slocality * L)
+{
+    if (!L->lasttime)
+        return;
+
+    stack_free (&L->K);
+    free (L->lasttime);
+    free (L->numpagerefs);
+    L->lasttime = NULL;
+}
+
+void annotate_reference (slocality * L, unsigned page)
+{
+    unsigned dist;
+
+    L->numrefs ++;
+
+    if (page >= L->numpages)
+    {
+        L->numillegal ++;
+        return;
+    }
+
+    // Reuse distance: pages referenced since the last time
+    dist = stack_reference (&L->K, page);
+
+    if (dist==STACK_COLD)
+        L->numcold ++;
+    else
+    {
+        histogram_add (&L->reuse, dist, 1);
+
+        // Gap: references since the last time (0 = never)
+        histogram_add (&L->gaps, L->numrefs - L->lasttime[page], 1);
+    }
+
+    L->lasttime[page] = L->numrefs;
+    L->numpagerefs[page] ++;
+
+    // Sequential runs: the same page goes on with the run, and
+    // so does the next one in the same direction
+    if (L->runlength && page==L->lastpage)
+        return;
+
+    if (L->runlength &&
+        (page==L->lastpage+1 || page==L->lastpage-1) &&
+        (!L->direction || L->direction==(int)(page-L->lastpage)))
+    {
+        L->direction = page - L->lastpage;
+        L->runlength ++;
+    }
+    else
+    {
+        end_runs (L);
+        L->runlength = 1;
+    }
+
+    L->lastpage = page;
+}
+
+void end_runs (slocality * L)
+{
+    if (L->runlength)
+        histogram_add (&L->runs, L->runlength, L->runlength);
+
+    L->runlength = 0;
+    L->direction = 0;
+}
+
+// Frequencies of the pages, sorted by rank. If they follow
+// Zipf's law, the frequency of rank r is proportional to
+// 1/r^a, which is a straight line of slope -a in a log-log
+// plot: a is fitted by least squares.
+
+static int decreasing (const void * a, const void * b)
+{
+    unsigned long long x = *(const unsigned long long*) a;
+    unsigned long long y = *(const unsigned long long*) b;
+
+    return x<y ? 1 : x>y ? -1 : 0;
+}
+
+void print_frequencies (const slocality * L)
+{
+    unsigned long long * freq, refs;
+    shistogram H;
+    double x, y, sx, sy, sxx, sxy, syy, slope, r2;
+    unsigned r, n;
+
+    freq = (unsigned long long*)
+           malloc (L->numpages*sizeof(unsigned long long) + 1);
+
+    if (!freq)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return;
+    }
+
+    memcpy (freq, L->numpagerefs,
+            L->numpages*sizeof(unsigned long long));
+    qsort (freq, L->numpages, sizeof(unsigned long long),
+           decreasing);
+
+    memset (&H, 0, sizeof(H));
+    sx = sy = sxx = sxy = syy = 0;
+    refs = 0;
+
+    for (r=1; r<=L->numpages && freq[r-1]; r++)
+    {
+        histogram_add (&H, r, freq[r-1]);
+        refs += freq[r-1];
+
+        x = log (r);
+        y = log (freq[r-1]);
+        sx += x;
+        sy += y;
+        sxx += x*x;
+        sxy += x*y;
+        syy += y*y;
+    }
+
+    n = r-1;
+
+    print_histogram (&H, "Page frequencies", "Rank",
+                     "References");
+
+    printf ("# Pages referenced:  %u\n", n);
+
+    if (n>1 && n*sxx-sx*sx > 0)
+    {
+        slope = (n*sxy - sx*sy) / (n*sxx - sx*sx);
+        r2 = n*syy-sy*sy > 0 ? slope*slope * (n*sxx-sx*sx) /
+                               (n*syy-sy*sy)
+                             : 1;
+        printf ("# Zipf exponent:  %f (R^2 = %f)\n", -slope, r2);
+    }
+
+    if (n)
+        printf ("# Most referenced page:  %f of the references\n",
+                freq[0] / (double) refs);
+
+    free (freq);
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/" \
+                         "HE4/HE8/HEB/NAT/TIM/BIT/LSD/MSD/CNT/" \
+                         "MMN/MMB/HJN/BTR/BFS"
+#define VALID_INITIAL_ORD "ASC/DES/RAN/NEA/FEW/SAW/ORG/ZIP/RUN/ADV"
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, opt;
+    const char * name = argv[0];
+
+    // Default parameters
+    p->pagesz = 16;
+    p->algorithm = "MER";
+    p->initialorder = "RAN";
+    p->numelem = 1000;
+    p->tracefile = NULL;
+    p->seed = 0;
+    p->outputs = ALL_OUTPUTS;
+
+    // Options, before the positional parameters
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "f:s:o:")) != -1)
+        switch (opt)
+        {
+            case 'f':
+                p->tracefile = optarg;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed");
+                    ok = 0;
+                }
+                break;
+
+            case 'o':
+                p->outputs = optarg;
+
+                if (strspn(optarg,ALL_OUTPUTS)!=strlen(optarg))
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong outputs\n");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
+
+    // With a trace file, there is no gen_trace to run
+    if (argc>5 || (p->tracefile && argc>2))
+        ok = 0;
+    else
+    {
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagesz)!=1 ||
+                       p->pagesz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size\n");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithm = argv[2];
+
+        if (strlen(p->algorithm)!=3 ||
+            strchr(p->algorithm,'/') ||
+            !strstr(VALID_ALGORITHMS,p->algorithm))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm\n");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialorder = argv[3];
+
+        if (strlen(p->initialorder)!=3 ||
+            strchr(p->initialorder,'/') ||
+            !strstr(VALID_INITIAL_ORD,p->initialorder))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial order\n");
+            ok = 0;
+        }
+
+        if (argc>4 && (sscanf(argv[4],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements\n");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    USAGE:\n\t%s [-o outputs] [-s seed] pagesz "
+                        "algorithm initialorder numelem\n"
+             "\t%s [-o outputs] -f trace pagesz\n\n", name, name);
+
+    fprintf (stderr,
+             "\tpagesz: # of elements that fit in a page\n"
+             "\talgorithm: sorting algorithm or workload (%s)\n"
+             "\tinitialorder: initial order of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\ttrace: trace file to replay (text or binary)\n"
+             "\t-o outputs: some of %s (all), for reuse "
+                          "distances, gaps,\n"
+             "\t            page frequencies and sequential runs\n"
+             "\t-s seed: seed of the random order and pivots (0)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INITIAL_ORD, ALL_OUTPUTS);
+
+    fprintf (stderr,
+             "    EXAMPLE:\n"
+             "\t%s -o rf 16 MER RAN 1000\n"
+             "\n",
+             name);
+
+    return -1;
+}
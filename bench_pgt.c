@@ -0,0 +1,296 @@
+/*
+    bench_pgt.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim_paging.h"
+
+// Benchmark of the layout of the page table. The same source
+// is built with each layout (bench_pgt_aos and bench_pgt_soa),
+// and runs the operations that the simulators do on the table
+// of N pages:
+//
+//   lookup   Random references: check the presence of the
+//            page and, if present, read its frame (sim_mmu)
+//   write    The same, marking the page modified
+//   scan     Count the pages present (print_page_table)
+//   lru      Find the present page with the oldest time mark
+//            (the victim of LRU(t))
+//   clock    Clear the referenced bit of the pages present
+//            (a full turn of FIFO 2nd chance)
+//
+// and prints the time per page or reference of each one, the
+// best of several repetitions.
+
+#ifdef SIM_PAGING_SOA
+#define LAYOUT  "SoA"
+#else
+#define LAYOUT  "AoS"
+#endif
+
+#define NUM_REFS  10000000   // References of lookup and write
+
+typedef struct
+{
+    int numreps;              // Repetitions of each operation
+    int percent;              // % of pages present
+    char ** sizes;            // # of pages, as given
+    int numsizes;
+}
+sparameters;
+
+int parse_command (int, char*[], sparameters*);
+
+// Small and fast generator (xorshift), so that it does not
+// dominate the references
+
+static unsigned next_random (unsigned * x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+
+    return *x;
+}
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec/1e9;
+}
+
+// Fill the table: a page is present with probability percent,
+// and has a random time mark
+
+static void fill_table (ssystem * S, int percent)
+{
+    unsigned x = 12345;
+    int p;
+
+    clear_page_table (S);
+
+    for (p=0; p<S->numpags; p++)
+        if (next_random(&x)%100 < percent)
+        {
+            PGT_SET_PRESENT (S, p, 1);
+            PGT_FRAME (S, p) = p;
+            PGT_TIMESTAMP (S, p) = next_random (&x);
+        }
+}
+
+// The operations. Each one returns a value that depends on all
+// the work, so that none can be optimized away
+
+static unsigned op_lookup (ssystem * S, int write)
+{
+    unsigned x = 54321, sum = 0, n;
+    int p;
+
+    for (n=0; n<NUM_REFS; n++)
+    {
+        p = next_random (&x) % S->numpags;
+
+        if (PGT_PRESENT(S,p))
+        {
+            sum += PGT_FRAME (S, p);
+
+            if (write)
+                PGT_SET_MODIFIED (S, p, 1);
+        }
+    }
+
+    return sum;
+}
+
+static unsigned op_scan (ssystem * S)
+{
+    unsigned count = 0;
+    int p;
+
+    for (p=0; p<S->numpags; p++)
+        if (PGT_PRESENT(S,p))
+            count ++;
+
+    return count;
+}
+
+static unsigned op_lru (ssystem * S)
+{
+    unsigned oldest = ~0U;
+    int p, victim = -1;
+
+    for (p=0; p<S->numpags; p++)
+        if (PGT_PRESENT(S,p) && PGT_TIMESTAMP(S,p) < oldest)
+        {
+            oldest = PGT_TIMESTAMP (S, p);
+            victim = p;
+        }
+
+    return victim;
+}
+
+static unsigned op_clock (ssystem * S)
+{
+    unsigned count = 0;
+    int p;
+
+    for (p=0; p<S->numpags; p++)
+        if (PGT_PRESENT(S,p))
+        {
+            count += PGT_REFERENCED (S, p);
+            PGT_SET_REFERENCED (S, p, 0);
+        }
+
+    return count;
+}
+
+// Best time, in ns per element, of the repetitions of one
+// operation (0 lookup, 1 write, 2 scan, 3 lru, 4 clock)
+
+static double run (ssystem * S, int op, int numreps,
+                   unsigned * check)
+{
+    double t, best = 0;
+    int r;
+
+    for (r=0; r<numreps; r++)
+    {
+        t = now ();
+
+        switch (op)
+        {
+            case 0:  *check += op_lookup (S, 0); break;
+            case 1:  *check += op_lookup (S, 1); break;
+            case 2:  *check += op_scan (S);      break;
+            case 3:  *check += op_lru (S);       break;
+            default: *check += op_clock (S);
+        }
+
+        t = now () - t;
+
+        if (r==0 || t<best)
+            best = t;
+    }
+
+    return best*1e9 / (op<2 ? NUM_REFS : S->numpags);
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;
+    ssystem S;
+    unsigned check = 0;
+    double mb;
+    int i, op;
+
+    if (!parse_command(argc,argv,&P))
+    {
+        fprintf (stderr,
+            "\n    SYNTAX:\n\n"
+            "%s [-r reps] [-p percent] numpages ...\n\n"
+            "        reps:      repetitions, the best counts (3)\n"
+            "        percent:   %% of pages present (50)\n"
+            "        numpages:  pages of the table (e.g. 1e6)\n\n",
+            argv[0]);
+        return -1;
+    }
+
+    printf ("# Layout: %s, %d%% present, best of %d\n",
+            LAYOUT, P.percent, P.numreps);
+    printf ("# Time in ns per reference (lookup, write) "
+            "or per page (scan, lru, clock)\n");
+    printf ("%6s %12s %9s %8s %8s %8s %8s %8s\n", "Layout",
+            "Pages", "MB", "lookup", "write", "scan", "lru",
+            "clock");
+
+    for (i=0; i<P.numsizes; i++)
+    {
+        memset (&S, 0, sizeof(S));
+        S.numpags = atof (P.sizes[i]);
+
+        if (S.numpags<1 || alloc_page_table(&S)<0)
+        {
+            fprintf (stderr, "ERROR: cannot create a table of "
+                             "%s pages\n", P.sizes[i]);
+            return -1;
+        }
+
+#ifdef SIM_PAGING_SOA
+        mb = S.numpags * (3/8.0 + sizeof(int) + sizeof(unsigned));
+#else
+        mb = S.numpags * (double) sizeof(spage);
+#endif
+
+        fill_table (&S, P.percent);
+
+        printf ("%6s %12d %9.1f", LAYOUT, S.numpags, mb/1e6);
+
+        for (op=0; op<5; op++)
+        {
+            printf (" %8.2f", run(&S,op,P.numreps,&check));
+            fflush (stdout);
+        }
+
+        printf ("\n");
+
+        free_page_table (&S);
+    }
+
+    printf ("# Check: %u\n", check);
+
+    return 0;
+}
+
+// Function that parses the parameters received through the
+// command line. Returns 1 if OK, 0 if wrong.
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int opt, ok;
+
+    p->numreps = 3;
+    p->percent = 50;
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "r:p:")) != -1)
+        switch (opt)
+        {
+            case 'r':
+                if (sscanf(optarg,"%d",&p->numreps)!=1 ||
+                    p->numreps<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "repetitions\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'p':
+                if (sscanf(optarg,"%d",&p->percent)!=1 ||
+                    p->percent<0 || p->percent>100)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong percentage\n");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    p->sizes = argv + optind;
+    p->numsizes = argc - optind;
+
+    return ok && p->numsizes>0;
+}
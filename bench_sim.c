@@ -0,0 +1,552 @@
+/*
+    bench_sim.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "trace.h"
+
+// Benchmark of the throughput of each stage of the simulation,
+// in references (reads and writes) per second:
+//
+//   gen         gen_trace writing a binary trace
+//   parse-txt   Reading a text trace (trace_next)
+//   parse-bin   Reading a binary trace
+//   sim-POLICY  sim_pag_POLICY replaying a binary trace, for
+//               every simulator that has been built
+//   ws          calculate_ws on a binary trace
+//
+// The trace of the workload is generated once, and the first
+// N references of it are taken for each size N. Every stage
+// runs some times to warm up (caches, page cache), and then
+// the repetitions that are measured; the minimum, the
+// percentiles 50 and 90 and the maximum of their times are
+// printed, and optionally saved in a CSV file. Given the file
+// of a previous run, the change of the median throughput is
+// shown, with the stages that got slower marked.
+
+#define MAX_REPS      1000
+#define MAX_STAGES    16
+#define MAX_RESULTS   256
+
+typedef struct
+{
+    int warmup, numreps;      // Runs not measured / measured
+    const char * algorithm, * initialorder;
+    int numelem;              // Workload
+    int pagsz, numframes;     // For the simulators
+    int interval;             // For calculate_ws
+    const char * output;      // CSV file (NULL = none)
+    const char * previous;    // CSV of a previous run
+    double threshold;         // Slowdown that is a regression
+    char ** sizes;            // # of references, as given
+    int numsizes;
+}
+sparameters;
+
+int parse_command (int, char*[], sparameters*);
+
+// Result of a stage with a size
+
+typedef struct
+{
+    char stage[32];
+    unsigned long long refs;
+    double min, p50, p90, max;  // Seconds
+}
+sresult;
+
+// Simulators that are measured, if they have been built
+
+const char * policies[] = { "random", "lru", "fifo", "fifo2ch" };
+
+#define NUM_POLICIES (sizeof(policies)/sizeof(policies[0]))
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec/1e9;
+}
+
+static int compare_doubles (const void * a, const void * b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return x<y ? -1 : x>y;
+}
+
+// Percentile q (0-100) of n sorted values, by interpolation
+
+static double percentile (const double * v, int n, double q)
+{
+    double k = (n-1) * q / 100;
+    int i = (int) k;
+
+    if (i+1>=n)
+        return v[n-1];
+
+    return v[i] + (k-i) * (v[i+1]-v[i]);
+}
+
+// Run a stage: a shell command, or reading a trace if command
+// is NULL. Return the time in seconds, or -1 if it failed.
+
+static double run_once (const char * command, const char * trace)
+{
+    strace T;
+    double t;
+    char op;
+    unsigned pos;
+
+    t = now ();
+
+    if (command)
+    {
+        if (system(command)!=0)
+            return -1;
+    }
+    else
+    {
+        if (trace_open_file(&T,trace)<0)
+            return -1;
+
+        while (trace_next(&T,&op,&pos) && op!='S' && op!='O')
+            ;
+
+        trace_close (&T);
+    }
+
+    return now () - t;
+}
+
+static int measure (const sparameters * P, const char * stage,
+                    const char * command, const char * trace,
+                    unsigned long long refs, sresult * R)
+{
+    double times[MAX_REPS];
+    int r;
+
+    for (r=0; r<P->warmup; r++)
+        if (run_once(command,trace)<0)
+            return -1;
+
+    for (r=0; r<P->numreps; r++)
+        if ((times[r] = run_once(command,trace))<0)
+            return -1;
+
+    qsort (times, P->numreps, sizeof(double), compare_doubles);
+
+    snprintf (R->stage, sizeof(R->stage), "%s", stage);
+    R->refs = refs;
+    R->min = times[0];
+    R->p50 = percentile (times, P->numreps, 50);
+    R->p90 = percentile (times, P->numreps, 90);
+    R->max = times[P->numreps-1];
+
+    return 0;
+}
+
+// Copy the first 'maxrefs' references of a trace (and the
+// comparisons between them) to a new one, in the given format.
+// Return the number of references copied, or 0 if it failed.
+
+static unsigned long long cut_trace (const char * from,
+                                     const char * to, int format,
+                                     unsigned long long maxrefs)
+{
+    strace T;
+    stracewriter W;
+    FILE * pf;
+    unsigned long long refs = 0;
+    unsigned pos;
+    char op;
+    int ok, opened;
+
+    if (trace_open_file(&T,from)<0)
+        return 0;
+
+    pf = fopen (to, "w");
+    ok = opened = pf && trace_writer_open(&W,pf,format,T.totelem)==0;
+
+    while (ok && refs<maxrefs && trace_next(&T,&op,&pos) &&
+           op!='S' && op!='O')
+    {
+        ok = trace_write_op (&W, op, pos) == 0;
+
+        if (op!='C')
+            refs ++;
+    }
+
+    if (opened && trace_writer_close(&W,1)<0)
+        ok = 0;
+
+    if (pf && fclose(pf)!=0)
+        ok = 0;
+
+    trace_close (&T);
+
+    return ok ? refs : 0;
+}
+
+// Count the references of a trace
+
+static unsigned long long count_refs (const char * path)
+{
+    strace T;
+    unsigned long long refs = 0;
+    unsigned pos;
+    char op;
+
+    if (trace_open_file(&T,path)<0)
+        return 0;
+
+    while (trace_next(&T,&op,&pos) && op!='S' && op!='O')
+        if (op!='C')
+            refs ++;
+
+    trace_close (&T);
+
+    return refs;
+}
+
+static void print_result (const sresult * R, FILE * csv,
+                          const char * workload)
+{
+    printf ("%-14s %12llu %9.4f %9.4f %9.4f %9.4f %12.4g\n",
+            R->stage, R->refs, R->min, R->p50, R->p90, R->max,
+            R->refs/R->p50);
+    fflush (stdout);
+
+    if (csv)
+        fprintf (csv, "%s,%s,%llu,%.6f,%.6f,%.6f,%.6f,%.6g\n",
+                 workload, R->stage, R->refs, R->min, R->p50,
+                 R->p90, R->max, R->refs/R->p50);
+}
+
+// Compare with the results of a previous run, for the same
+// workload
+
+static void compare (const sparameters * P, const sresult * R,
+                     int numresults, const char * workload)
+{
+    FILE * pf;
+    char line[256], load[64], stage[32];
+    unsigned long long refs;
+    double p50, before, after, change;
+    int i, first = 1;
+
+    pf = fopen (P->previous, "r");
+
+    if (!pf)
+    {
+        perror ("ERROR opening the previous results");
+        return;
+    }
+
+    while (fgets(line,sizeof(line),pf))
+    {
+        if (sscanf(line,"%63[^,],%31[^,],%llu,%*f,%lf",load,stage,
+                   &refs,&p50)!=4 || strcmp(load,workload))
+            continue;
+
+        for (i=0; i<numresults; i++)
+            if (!strcmp(R[i].stage,stage) && R[i].refs==refs)
+                break;
+
+        if (i==numresults || p50<=0)
+            continue;
+
+        if (first)
+        {
+            printf ("\n# Change of the median throughput with "
+                    "respect to %s\n", P->previous);
+            printf ("%-14s %12s %12s %12s %8s\n", "Stage", "Refs",
+                    "Before", "After", "Change");
+            first = 0;
+        }
+
+        before = refs / p50;
+        after = R[i].refs / R[i].p50;
+        change = 100 * (after-before) / before;
+
+        printf ("%-14s %12llu %12.4g %12.4g %+7.1f%%%s\n",
+                stage, refs, before, after, change,
+                change < -P->threshold ? "  <-- SLOWER" : "");
+    }
+
+    fclose (pf);
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;
+    sresult R[MAX_RESULTS];
+    char dir[] = "/tmp/bench_sim.XXXXXX";
+    char base[FILENAME_MAX], bin[FILENAME_MAX], txt[FILENAME_MAX];
+    char command[4*FILENAME_MAX], stage[32], workload[64];
+    unsigned long long refs, total;
+    FILE * csv = NULL;
+    int numresults = 0, i, ok = 1;
+    unsigned p;
+
+    if (!parse_command(argc,argv,&P))
+    {
+        fprintf (stderr,
+            "\n    SYNTAX:\n\n"
+            "%s [-w warmup] [-r reps] [-a alg,order,numelem]\n"
+            "       [-p pagesz,frames] [-i interval] [-o results.csv]"
+            "\n       [-c previous.csv] [-t percent] refs ...\n\n"
+            "        warmup:    runs not measured (1)\n"
+            "        reps:      runs measured (5)\n"
+            "        alg...:    workload (INS,RAN,5000)\n"
+            "        pagesz...: for the simulators (16,64)\n"
+            "        interval:  for calculate_ws (2000)\n"
+            "        percent:   slowdown that is marked (5)\n"
+            "        refs:      references of each size "
+                                "(e.g. 1e5 1e6 1e7)\n\n",
+            argv[0]);
+        return -1;
+    }
+
+    if (!mkdtemp(dir))
+    {
+        perror ("ERROR creating a temporary directory");
+        return -1;
+    }
+
+    snprintf (base, sizeof(base), "%s/base.trace", dir);
+    snprintf (bin, sizeof(bin), "%s/bin.trace", dir);
+    snprintf (txt, sizeof(txt), "%s/txt.trace", dir);
+
+    if (P.output)
+    {
+        csv = fopen (P.output, "w");
+
+        if (!csv)
+        {
+            perror ("ERROR creating the results file");
+            ok = 0;
+        }
+        else
+            fprintf (csv, "workload,stage,refs,min_s,p50_s,p90_s,"
+                          "max_s,refs_per_s\n");
+    }
+
+    // Key of the results in the CSV files
+    snprintf (workload, sizeof(workload), "%s:%s:%d:%d:%d",
+              P.algorithm, P.initialorder, P.numelem, P.pagsz,
+              P.numframes);
+
+    printf ("# Workload: %s %s %d, pages of %d, %d frames, "
+            "%d+%d runs\n", P.algorithm, P.initialorder, P.numelem,
+            P.pagsz, P.numframes, P.warmup, P.numreps);
+    printf ("%-14s %12s %9s %9s %9s %9s %12s\n", "Stage", "Refs",
+            "Min(s)", "P50(s)", "P90(s)", "Max(s)", "Refs/s");
+
+    // Generation of the whole trace
+
+    snprintf (command, sizeof(command),
+              "./gen_trace -b %s %s %d > %s", P.algorithm,
+              P.initialorder, P.numelem, base);
+
+    if (ok && (run_once(command,NULL)<0 || !(total=count_refs(base))))
+    {
+        fprintf (stderr, "ERROR running gen_trace\n");
+        ok = 0;
+    }
+
+    if (ok && measure(&P,"gen",command,NULL,total,&R[numresults])==0)
+        print_result (&R[numresults++], csv, workload);
+
+    for (i=0; ok && i<P.numsizes; i++)
+    {
+        refs = atof (P.sizes[i]);
+
+        if (refs>total)
+        {
+            fprintf (stderr, "WARNING: the workload has only %llu "
+                             "references\n", total);
+            refs = total;
+        }
+
+        if (cut_trace(base,bin,TRACE_BINARY,refs)!=refs ||
+            cut_trace(base,txt,TRACE_TEXT,refs)!=refs)
+        {
+            fprintf (stderr, "ERROR writing the traces\n");
+            ok = 0;
+            break;
+        }
+
+        if (numresults+MAX_STAGES > MAX_RESULTS)
+            break;
+
+        if (measure(&P,"parse-txt",NULL,txt,refs,&R[numresults])==0)
+            print_result (&R[numresults++], csv, workload);
+
+        if (measure(&P,"parse-bin",NULL,bin,refs,&R[numresults])==0)
+            print_result (&R[numresults++], csv, workload);
+
+        for (p=0; p<NUM_POLICIES; p++)
+        {
+            snprintf (command, sizeof(command), "./sim_pag_%s",
+                      policies[p]);
+
+            if (access(command,X_OK)!=0)
+                continue;
+
+            snprintf (command, sizeof(command),
+                      "./sim_pag_%s -f %s %d %d > /dev/null",
+                      policies[p], bin, P.pagsz, P.numframes);
+            snprintf (stage, sizeof(stage), "sim-%s", policies[p]);
+
+            if (measure(&P,stage,command,NULL,refs,
+                        &R[numresults])==0)
+                print_result (&R[numresults++], csv, workload);
+            else
+                fprintf (stderr, "ERROR running sim_pag_%s\n",
+                         policies[p]);
+        }
+
+        snprintf (command, sizeof(command),
+                  "./calculate_ws -f %s %d %d > /dev/null",
+                  bin, P.pagsz, P.interval);
+
+        if (measure(&P,"ws",command,NULL,refs,&R[numresults])==0)
+            print_result (&R[numresults++], csv, workload);
+        else
+            fprintf (stderr, "ERROR running calculate_ws\n");
+    }
+
+    if (csv && fclose(csv)!=0)
+    {
+        perror ("ERROR writing the results file");
+        ok = 0;
+    }
+
+    if (P.previous)
+        compare (&P, R, numresults, workload);
+
+    unlink (base);
+    unlink (bin);
+    unlink (txt);
+    rmdir (dir);
+
+    return ok ? 0 : -1;
+}
+
+// Function that parses the parameters received through the
+// command line. Returns 1 if OK, 0 if wrong.
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    static char algorithm[16], initialorder[16];
+    int opt, ok;
+
+    p->warmup = 1;
+    p->numreps = 5;
+    p->algorithm = "INS";
+    p->initialorder = "RAN";
+    p->numelem = 5000;
+    p->pagsz = 16;
+    p->numframes = 64;
+    p->interval = 2000;
+    p->output = NULL;
+    p->previous = NULL;
+    p->threshold = 5;
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "w:r:a:p:i:o:c:t:")) != -1)
+        switch (opt)
+        {
+            case 'w':
+                if (sscanf(optarg,"%d",&p->warmup)!=1 ||
+                    p->warmup<0)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "warm-up runs\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'r':
+                if (sscanf(optarg,"%d",&p->numreps)!=1 ||
+                    p->numreps<1 || p->numreps>MAX_REPS)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "repetitions\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'a':
+                if (sscanf(optarg,"%15[^,],%15[^,],%d",algorithm,
+                           initialorder,&p->numelem)!=3)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong workload\n");
+                    ok = 0;
+                }
+
+                p->algorithm = algorithm;
+                p->initialorder = initialorder;
+                break;
+
+            case 'p':
+                if (sscanf(optarg,"%d,%d",&p->pagsz,
+                           &p->numframes)!=2 ||
+                    p->pagsz<1 || p->numframes<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong page size or "
+                                          "frames\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'i':
+                if (sscanf(optarg,"%d",&p->interval)!=1 ||
+                    p->interval<2)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong interval\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'o':
+                p->output = optarg;
+                break;
+
+            case 'c':
+                p->previous = optarg;
+                break;
+
+            case 't':
+                if (sscanf(optarg,"%lf",&p->threshold)!=1 ||
+                    p->threshold<0)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong threshold\n");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    p->sizes = argv + optind;
+    p->numsizes = argc - optind;
+
+    return ok && p->numsizes>0;
+}
@@ -0,0 +1,210 @@
+/*
+    bench_sort.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "bitonic.h"
+#include "xoshiro.h"
+
+// Benchmark of the bitonic sort (BIT of gen_trace) on the
+// machine itself: arrays of things in random order, sorted with
+// no functions to read, write and compare them, and nothing
+// traced, so it is the ceiling of what the algorithm can do. It
+// is compared with the qsort of the C library, and prints the
+// millions of things sorted per second of each one, the best of
+// several repetitions, for each size and each size of the
+// blocks.
+
+typedef struct
+{
+    int numreps;              // Repetitions of each sort
+    unsigned long long seed;  // Of the random things
+    char ** sizes;            // # of things, as given
+    int numsizes;
+}
+sparameters;
+
+int parse_command (int, char*[], sparameters*);
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec/1e9;
+}
+
+static int compare (const void * a, const void * b)
+{
+    thing x = *(const thing*) a, y = *(const thing*) b;
+
+    return x<y ? -1 : x>y;
+}
+
+// Best time of the repetitions, each one on a copy of the data.
+// block 0 is qsort. Returns -1 if the result is not sorted.
+
+static double run (const thing * data, thing * a, thing * temp,
+                   unsigned size, unsigned block, int numreps)
+{
+    double t, best = 0;
+    unsigned u;
+    int r;
+
+    for (r=0; r<numreps; r++)
+    {
+        memcpy (a, data, size*sizeof(thing));
+
+        t = now ();
+
+        if (block)
+            bitonic_sort_native (a, temp, size, block);
+        else
+            qsort (a, size, sizeof(thing), compare);
+
+        t = now () - t;
+
+        for (u=1; u<size; u++)
+            if (a[u]<a[u-1])
+                return -1;
+
+        if (r==0 || t<best)
+            best = t;
+    }
+
+    return best;
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;
+    sxoshiro X;
+    thing * data, * a, * temp;
+    unsigned size, u, block;
+    char name[16];
+    double t;
+    int i;
+
+    if (!parse_command(argc,argv,&P))
+    {
+        fprintf (stderr,
+            "\n    SYNTAX:\n\n"
+            "%s [-r reps] [-s seed] size ...\n\n"
+            "        reps:  repetitions, the best counts (3)\n"
+            "        seed:  of the random things (1)\n"
+            "        size:  things to sort (e.g. 1e6)\n\n",
+            argv[0]);
+        return -1;
+    }
+
+    printf ("# Bitonic networks: %s, best of %d\n",
+            bitonic_isa, P.numreps);
+    printf ("# Millions of things sorted per second\n");
+    printf ("%12s %8s", "Size", "qsort");
+
+    for (block=BITONIC_MIN_BLOCK; block<=BITONIC_MAX_BLOCK; block*=2)
+    {
+        sprintf (name, "BIT %u", block);
+        printf (" %8s", name);
+    }
+
+    printf ("\n");
+
+    for (i=0; i<P.numsizes; i++)
+    {
+        size = atof (P.sizes[i]);
+
+        data = (thing*) malloc (size*sizeof(thing));
+        a = (thing*) malloc (size*sizeof(thing));
+        temp = (thing*) malloc (size*sizeof(thing));
+
+        if (size<1 || !data || !a || !temp)
+        {
+            fprintf (stderr, "ERROR: cannot sort %s things\n",
+                     P.sizes[i]);
+            return -1;
+        }
+
+        // Integers of 53 bits, exact as doubles
+        xoshiro_seed (&X, P.seed);
+
+        for (u=0; u<size; u++)
+            data[u] = xoshiro_next (&X) >> 11;
+
+        printf ("%12u", size);
+
+        for (block=0; block<=BITONIC_MAX_BLOCK;
+             block = block ? block*2 : BITONIC_MIN_BLOCK)
+        {
+            t = run (data, a, temp, size, block, P.numreps);
+
+            if (t<0)
+            {
+                fprintf (stderr, "\nERROR: not sorted with "
+                                 "blocks of %u\n", block);
+                return -1;
+            }
+
+            printf (" %8.2f", size/t/1e6);
+            fflush (stdout);
+        }
+
+        printf ("\n");
+
+        free (data);
+        free (a);
+        free (temp);
+    }
+
+    return 0;
+}
+
+// Function that parses the parameters received through the
+// command line. Returns 1 if OK, 0 if wrong.
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int opt, ok;
+
+    p->numreps = 3;
+    p->seed = 1;
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "r:s:")) != -1)
+        switch (opt)
+        {
+            case 'r':
+                if (sscanf(optarg,"%d",&p->numreps)!=1 ||
+                    p->numreps<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "repetitions\n");
+                    ok = 0;
+                }
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%llu",&p->seed)!=1)
+                {
+                    fprintf (stderr, "\n    ERROR: wrong seed\n");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    p->sizes = argv + optind;
+    p->numsizes = argc - optind;
+
+    return ok && p->numsizes>0;
+}
@@ -0,0 +1,266 @@
+/*
+    bitonic.c
+*/
+
+#include <string.h>
+#include <math.h>
+
+#include "bitonic.h"
+
+// A vector of W things, and its operations: load and store
+// (unaligned), minimum and maximum of each lane, swap of the
+// lanes t and t^j, and blend (the lanes whose bit is set in
+// mask are taken from b, the rest from a)
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+
+#define W 8
+
+typedef __m512d vec;
+
+const char * const bitonic_isa = "AVX-512";
+
+#define VLOAD(p)      _mm512_loadu_pd (p)
+#define VSTORE(p,v)   _mm512_storeu_pd (p, v)
+#define VMIN(a,b)     _mm512_min_pd (a, b)
+#define VMAX(a,b)     _mm512_max_pd (a, b)
+
+static vec vswap (vec v, unsigned j)
+{
+    return _mm512_permutexvar_pd (_mm512_set_epi64 (7^j, 6^j, 5^j, 4^j,
+                                                    3^j, 2^j, 1^j, 0^j),
+                                  v);
+}
+
+static vec vblend (vec a, vec b, unsigned mask)
+{
+    return _mm512_mask_blend_pd ((__mmask8) mask, a, b);
+}
+
+#elif defined(__AVX2__)
+
+#include <immintrin.h>
+
+#define W 4
+
+typedef __m256d vec;
+
+const char * const bitonic_isa = "AVX2";
+
+#define VLOAD(p)      _mm256_loadu_pd (p)
+#define VSTORE(p,v)   _mm256_storeu_pd (p, v)
+#define VMIN(a,b)     _mm256_min_pd (a, b)
+#define VMAX(a,b)     _mm256_max_pd (a, b)
+
+static vec vswap (vec v, unsigned j)
+{
+    if (j==1)           // Neighbours
+        return _mm256_permute_pd (v, 0x5);
+    else if (j==2)      // Halves
+        return _mm256_permute2f128_pd (v, v, 0x1);
+    else                // Reversed
+        return _mm256_permute4x64_pd (v, 0x1B);
+}
+
+static vec vblend (vec a, vec b, unsigned mask)
+{
+    return _mm256_blendv_pd (a, b, _mm256_castsi256_pd (
+                             _mm256_set_epi64x (-(long long) (mask>>3&1),
+                                                -(long long) (mask>>2&1),
+                                                -(long long) (mask>>1&1),
+                                                -(long long) (mask&1))));
+}
+
+#else
+
+// Without vector instructions, a "vector" is a single thing, and
+// there is nothing to swap nor blend inside it
+
+#define W 1
+
+typedef thing vec;
+
+const char * const bitonic_isa = "scalar";
+
+#define VLOAD(p)      (*(p))
+#define VSTORE(p,v)   (*(p) = (v))
+#define VMIN(a,b)     ((a)<(b) ? (a) : (b))
+#define VMAX(a,b)     ((a)<(b) ? (b) : (a))
+
+static vec vswap (vec v, unsigned j)
+{
+    return v;
+}
+
+static vec vblend (vec a, vec b, unsigned mask)
+{
+    return mask ? b : a;
+}
+
+#endif
+
+#define FULL ((1U<<W)-1)   // All the lanes
+
+// Lanes that take the maximum of the pairs at distance j, when
+// sorting up
+
+static unsigned upper_lanes (unsigned j)
+{
+    unsigned t, mask;
+
+    for (mask=t=0; t<W; t++)
+        if (t&j)
+            mask |= 1U<<t;
+
+    return mask;
+}
+
+// Compare-exchange of each pair of lanes at distance j (less
+// than W) of the vector v, and put the maximum where mask says
+
+static vec exchange_lanes (vec v, unsigned j, unsigned mask)
+{
+    vec w = vswap (v, j);
+
+    return vblend (VMIN(v,w), VMAX(v,w), mask);
+}
+
+// Sort the bitonic sequence in v (ascending). Each step leaves
+// the lower half of the lanes under the upper half, as every
+// pair at distance j.
+
+static vec clean_lanes (vec v)
+{
+    unsigned j;
+
+    for (j=W/2; j>0; j/=2)
+        v = exchange_lanes (v, j, upper_lanes(j));
+
+    return v;
+}
+
+void bitonic_block (thing * a, unsigned n)
+{
+    unsigned i, j, k, mask;
+    vec x, y;
+
+    // Sequences of k things: the first half sorted up and the
+    // second one down (bitonic), merged by steps of distance j
+    for (k=2; k<=n; k*=2)
+        for (j=k/2; j>0; j/=2)
+            if (j>=W)
+            {
+                // Whole vectors against whole vectors, in the
+                // direction of their sequence
+                for (i=0; i<n; i+=W)
+                    if (!(i&j))
+                    {
+                        x = VLOAD (a+i);
+                        y = VLOAD (a+i+j);
+
+                        if (i&k)
+                        {
+                            VSTORE (a+i, VMAX(x,y));
+                            VSTORE (a+i+j, VMIN(x,y));
+                        }
+                        else
+                        {
+                            VSTORE (a+i, VMIN(x,y));
+                            VSTORE (a+i+j, VMAX(x,y));
+                        }
+                    }
+            }
+            else
+            {
+                // Inside each vector. Sequences shorter than a
+                // vector alternate their direction in its lanes.
+                mask = upper_lanes (j);
+
+                if (k<W)
+                    mask ^= upper_lanes (k);
+
+                for (i=0; i<n; i+=W)
+                    VSTORE (a+i, exchange_lanes (VLOAD(a+i), j,
+                                                 i&k ? mask^FULL : mask));
+            }
+}
+
+void bitonic_merge (thing * dest, const thing * a, unsigned left,
+                    const thing * b, unsigned right)
+{
+    thing carry[W];
+    unsigned u=0, v=0, c=0, numcarry=0;
+    vec x, y;
+
+    if (W>1 && left>=W && right>=W)
+    {
+        // x holds the W greatest things merged so far. With the
+        // next vector reversed, the minimums and the maximums of
+        // each lane are two bitonic sequences: the lower W
+        // things, written, and the upper W, kept.
+        for (x=VLOAD(a), u=W; u+W<=left && v+W<=right; dest+=W)
+        {
+            if (a[u]<b[v])
+            {
+                y = vswap (VLOAD(a+u), W-1);
+                u += W;
+            }
+            else
+            {
+                y = vswap (VLOAD(b+v), W-1);
+                v += W;
+            }
+
+            VSTORE (dest, clean_lanes (VMIN(x,y)));
+            x = clean_lanes (VMAX(x,y));
+        }
+
+        VSTORE (carry, x);
+        numcarry = W;
+    }
+
+    // The rest, one by one, from the vector kept and both runs
+    while (c<numcarry || u<left || v<right)
+        if (c<numcarry && (u==left || carry[c]<=a[u]) &&
+            (v==right || carry[c]<=b[v]))
+            *dest++ = carry[c++];
+        else if (u<left && (v==right || a[u]<=b[v]))
+            *dest++ = a[u++];
+        else
+            *dest++ = b[v++];
+}
+
+void bitonic_sort_native (thing * a, thing * temp, unsigned size,
+                          unsigned block)
+{
+    thing last[BITONIC_MAX_BLOCK], * from, * to, * t;
+    unsigned u, v, width, left, right;
+
+    for (u=0; u+block<=size; u+=block)
+        bitonic_block (a+u, block);
+
+    // The last block, filled up with infinites
+    if (u<size)
+    {
+        for (v=0; v<block; v++)
+            last[v] = u+v<size ? a[u+v] : HUGE_VAL;
+
+        bitonic_block (last, block);
+        memcpy (a+u, last, (size-u)*sizeof(thing));
+    }
+
+    for (from=a, to=temp, width=block; width<size;
+         width*=2, t=from, from=to, to=t)
+        for (u=0; u<size; u+=left+right)
+        {
+            left = size-u<width ? size-u : width;
+            right = size-u-left<width ? size-u-left : width;
+
+            bitonic_merge (to+u, from+u, left, from+u+left, right);
+        }
+
+    if (from!=a)
+        memcpy (a, from, size*sizeof(thing));
+}
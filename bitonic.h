@@ -0,0 +1,44 @@
+/*
+    bitonic.h
+*/
+
+#ifndef _BITONIC_H_
+#define _BITONIC_H_
+
+#include "sort.h"
+
+// Bitonic sorting networks (Batcher) on plain arrays of things,
+// with the vector instructions that the compiler is allowed to
+// use: AVX-512 (8 things per register), AVX2 (4), or none (a
+// scalar compare-exchange). They are chosen when bitonic.o is
+// compiled ("make SORT_FLAGS=-march=native", after "make
+// clean"). The comparisons are made in the registers, so the
+// things must be doubles and not NaN.
+
+// Name of the instructions in use ("AVX-512", "AVX2" or
+// "scalar")
+
+extern const char * const bitonic_isa;
+
+// Sort the block a[0..n-1], n a power of 2 from
+// BITONIC_MIN_BLOCK to BITONIC_MAX_BLOCK
+
+void bitonic_block (thing * a, unsigned n);
+
+// Merge the sorted runs a[0..left-1] and b[0..right-1] into
+// dest, a vector at a time: the last vector written is merged
+// by a network with the next one of the run with the smaller
+// head
+
+void bitonic_merge (thing * dest, const thing * a, unsigned left,
+                    const thing * b, unsigned right);
+
+// Sort the whole array in blocks of 'block' things (a power of
+// 2, as above), merged back and forth with temp (of the same
+// size). Nothing is traced: it gives the throughput of the
+// machine itself.
+
+void bitonic_sort_native (thing * a, thing * temp, unsigned size,
+                          unsigned block);
+
+#endif // _BITONIC_H_
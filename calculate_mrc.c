@@ -0,0 +1,1041 @@
+/*
+    calculate_mrc.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+
+#include "trace.h"
+#include "trace_cache.h"
+#include "trace_codec.h"
+#include "stack_dist.h"
+
+// Structure holding data of the parameters passed through
+// the command line (algorithm to be used etc.)
+
+typedef struct
+{
+    int pagesz;
+    const char * algorithm, * initialorder;
+    int numelem;
+    const char * tracefile;   // Trace file (NULL = run gen_trace)
+    unsigned seed;            // Seed for gen_trace
+    int numthreads;           // Worker threads (1 = serial)
+    double rate;              // Sampling rate (1 = all pages)
+    unsigned maxsample;       // Max. sampled pages (0 = no max.)
+    int exact;                // 1 = compare with the exact curve
+}
+sparameters;
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int, char*[], sparameters*);
+
+// Histogram of the stack distances of the references: the
+// miss ratio curve of LRU for any number of frames follows
+// from it
+
+typedef struct
+{
+    unsigned numpages;             // # of pages
+    unsigned long long * hist;     // References per distance
+    unsigned long long numcold;    // First references
+    unsigned long long numrefs;    // Total # of references
+    unsigned long long numillegal; // References out of range
+}
+sdistances;
+
+int reserve_distances (sdistances *, unsigned numpages);
+void free_distances (sdistances *);
+
+void print_curve (const sdistances *);
+
+// Serial computation: one stack for the whole trace, read
+// operation by operation
+
+int serial_distances (strace *, int pagesz, sdistances *);
+
+// Sampled computation (SHARDS, Waldspurger et al.): only the
+// pages whose hash falls below a threshold are followed, and
+// the pages referenced in between two references to one of
+// them are scaled by the inverse of the sampling rate to get
+// the stack distance. The stack only holds sampled
+// pages, so the memory is proportional to them.
+//
+// With a fixed rate, the threshold stays the same. With a fixed
+// size, when there are too many sampled pages, the threshold is
+// lowered to the largest hash among them, and those pages are
+// dropped; what has been counted so far is rescaled to the new
+// rate. At the end, the difference between the expected and
+// the actual number of sampled references is added to the
+// smallest distances, which corrects most of the bias.
+//
+// Distances are counted in buckets of 'width' frames, to keep
+// the histogram small with huge address spaces.
+
+#define SHARDS_BITS     24                // Bits of the hash
+#define SHARDS_MAX      (1U<<SHARDS_BITS) // Threshold = all
+#define MRC_BUCKETS     65536             // Max. # of buckets
+
+typedef struct
+{
+    unsigned numpages;        // # of pages
+    unsigned threshold;       // Pages with hash < threshold
+    unsigned maxpages;        // Max. sampled pages (or 0)
+    sstack K;                 // Stack of the sampled pages
+    unsigned * heap;          // Sampled pages (max-heap by
+    unsigned numheap;         //  hash), only with fixed size
+    unsigned width;           // Frames per bucket
+    unsigned numbuckets;      // Buckets of distances
+    double * hist;            // References per bucket
+    double numcold;           // First references
+    double numsampled;        // Sampled references
+    unsigned long long numrefs;    // Total # of references
+    unsigned long long numillegal; // References out of range
+}
+sshards;
+
+int reserve_shards (sshards *, unsigned numpages,
+                    double rate, unsigned maxpages);
+void free_shards (sshards *);
+
+int sampled_distances (strace *, int pagesz, sshards *,
+                       sdistances * exact);
+void print_sampled_curve (const sshards *,
+                          const sdistances * exact);
+
+// Parallel computation. The blocks of a mapped trace are split
+// in one chunk per thread, and each worker computes the
+// distances of the references of its chunk, with a stack of
+// its own. A reference to a page already referenced in the
+// chunk gets the same distance as in the whole trace, since
+// all the pages referenced in between are in the chunk too.
+//
+// The first reference of each page in the chunk is left for
+// the merge phase, that goes through the chunks in order with
+// a global stack. It replays only the first references of the
+// chunk, which get their true distance: the pages referenced
+// earlier in the chunk are moved to the top of the stack, just
+// before them. Then it moves the pages of the chunk to the top
+// again, in order of their last reference, leaving the stack
+// as it would be after the whole chunk. The merge costs two
+// references per different page of each chunk, instead of one
+// per reference.
+
+typedef struct
+{
+    const strace * T;         // Trace (mapped)
+    int pagesz;
+    unsigned firstblock;      // Blocks of the chunk:
+    unsigned endblock;        //  [firstblock, endblock)
+    sdistances D;             // Distances within the chunk
+    unsigned * first;         // Pages in order of first ref.
+    unsigned numfirst;
+    unsigned * last;          // Pages in order of last ref.
+    unsigned numlast;
+    char end;                 // End mark ('S', 'O' or 0)
+    int ok;                   // 0 = error in the worker
+}
+schunk;
+
+void * chunk_worker (void *);
+int parallel_distances (const strace *, int pagesz,
+                        int numthreads, sdistances *);
+
+// Main function
+
+int main (int argc, char * argv[])
+{
+    sparameters P;      // Parameters received in the command line
+    char source[FILENAME_MAX];  // Cached trace (or command)
+    strace T;           // Trace being read
+    int ok, hit;        // Flags
+    int sampled;        // 1 = sample the pages
+    unsigned numpags;   // Total number of pages
+    int numthreads;     // Threads actually used
+    sdistances D;       // Histogram of distances
+    sshards H;          // Histogram of sampled distances
+    struct timespec t0, t1;
+
+    D.hist = NULL;
+    H.hist = NULL;
+
+    if (parse_command(argc,argv,&P)<0)  // Put parameters in P
+        return -1;
+
+    if (P.tracefile)
+    {
+        printf ("# Parameters:  %s %i\n", argv[0], P.pagesz);
+
+        printf ("# Reading trace:  %s\n", P.tracefile);
+
+        // Map the file in memory and read the total # of
+        // elements
+        if (trace_open_file(&T,P.tracefile)<0)
+        {
+            perror ("ERROR while opening the trace");
+            return -1;
+        }
+    }
+    else
+    {
+        printf ("# Parameters:  %s %i %s %s %i\n",
+                argv[0], P.pagesz,
+                P.algorithm, P.initialorder, P.numelem);
+
+        // Take the trace from the cache, or generate it by
+        // invoking gen_trace
+        hit = trace_cache_open (&T, P.algorithm, P.initialorder,
+                                P.numelem, P.seed,
+                                source, sizeof(source));
+
+        if (hit<0)
+        {
+            perror ("ERROR while starting gen_trace");
+            return -1;
+        }
+
+        printf ("# Trace:  %s (%s)\n", source,
+                hit ? "cached" : "generated");
+    }
+
+    ok = T.totelem > 0;
+    sampled = P.rate<1 || P.maxsample;
+
+    if (ok)
+    {
+        // Calculate total number of pages
+        numpags = (T.totelem+P.pagesz-1) / P.pagesz;
+
+        if ((sampled && reserve_shards(&H,numpags,P.rate,
+                                       P.maxsample)<0) ||
+            ((!sampled || P.exact) &&
+             reserve_distances(&D,numpags)<0))
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+    {
+        // Text traces and pipes can only be read in order
+        numthreads = P.numthreads;
+
+        if (numthreads > (int) trace_num_blocks(&T))
+            numthreads = trace_num_blocks (&T);
+
+        clock_gettime (CLOCK_MONOTONIC, &t0);
+
+        if (sampled)
+        {
+            if (P.maxsample)
+                printf ("# Engine:  sampled, max. %u pages\n",
+                        P.maxsample);
+            else
+                printf ("# Engine:  sampled, rate %g\n", P.rate);
+
+            ok = sampled_distances (&T, P.pagesz, &H,
+                                    P.exact ? &D : NULL) == 0;
+        }
+        else if (numthreads>1)
+        {
+            printf ("# Engine:  parallel, %d threads\n",
+                    numthreads);
+            ok = parallel_distances (&T, P.pagesz,
+                                     numthreads, &D) == 0;
+        }
+        else
+        {
+            printf ("# Engine:  serial\n");
+            ok = serial_distances (&T, P.pagesz, &D) == 0;
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &t1);
+    }
+
+    if (ok)
+    {
+        printf ("# Time:  %.3f s\n", t1.tv_sec-t0.tv_sec +
+                                     (t1.tv_nsec-t0.tv_nsec)/1e9);
+
+        if (sampled)
+            print_sampled_curve (&H, P.exact ? &D : NULL);
+        else
+            print_curve (&D);
+
+        if (sampled ? H.numillegal : D.numillegal)
+            printf ("WARNING: There were %llu references to "
+                             "nonexistent pages\n",
+                    sampled ? H.numillegal : D.numillegal);
+    }
+
+    // Wait until gen_trace ends and close
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    free_distances (&D);
+    free_shards (&H);
+
+    return ok ? 0 : -1;
+}
+
+// Functions that manipulate the histogram of distances
+
+int reserve_distances (sdistances * D, unsigned numpages)
+{
+    D->numpages = numpages;
+    D->numcold = D->numrefs = D->numillegal = 0;
+    D->hist = (unsigned long long*)
+              calloc (numpages+1, sizeof(unsigned long long));
+
+    return D->hist ? 0 : -1;
+}
+
+void free_distances (sdistances * D)
+{
+    free (D->hist);
+    D->hist = NULL;
+}
+
+// With F frames, LRU fails on the first references and on the
+// references with distance greater than F. Print one line
+// for each number of frames where the curve goes down.
+
+void print_curve (const sdistances * D)
+{
+    unsigned long long refs, faults;
+    unsigned f, maxdist;
+
+    refs = D->numrefs - D->numillegal;
+
+    for (f=maxdist=1; f<=D->numpages; f++)
+        if (D->hist[f])
+            maxdist = f;
+
+    printf ("# References:  %llu\n"
+            "# First references:  %llu\n"
+            "# Max. distance:  %u\n",
+            refs, D->numcold, maxdist);
+
+    printf ("#\n#%14s %15s %15s\n#\n",
+            "Frames", "Faults", "Miss ratio");
+
+    for (f=1, faults=refs; f<=maxdist; f++)
+    {
+        faults -= D->hist[f];
+
+        if (f==1 || D->hist[f])
+            printf (" %14u %15llu %15f\n", f, faults,
+                    refs ? faults / (double) refs : 0);
+    }
+}
+
+// Serial computation
+
+int serial_distances (strace * T, int pagesz, sdistances * D)
+{
+    sstack K;
+    unsigned u, page, dist;
+    char op = 0;
+
+    if (stack_init(&K,D->numpages)<0)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (;;)
+    {
+        // Read one operation (and the element, if R/W)
+        if (trace_next(T,&op,&u)!=1)
+            break;
+
+        if (op=='R' || op=='W')
+        {
+            D->numrefs ++;
+            page = u / pagesz;
+
+            if (page < D->numpages)
+            {
+                dist = stack_reference (&K, page);
+
+                if (dist==STACK_COLD)
+                    D->numcold ++;
+                else
+                    D->hist[dist] ++;
+            }
+            else
+                D->numillegal ++;
+        }
+        else if (op!='C')        // 'S'orted or 'O'ut of order
+            break;
+    }
+
+    stack_free (&K);
+
+    return op=='S' ? 0 : -1;
+}
+
+// Sampled computation
+
+// Hash of the page, uniform in [0, SHARDS_MAX)
+
+static unsigned page_hash (unsigned page)
+{
+    page ^= page >> 16;
+    page *= 0x85ebca6bU;
+    page ^= page >> 13;
+    page *= 0xc2b2ae35U;
+    page ^= page >> 16;
+
+    return page & (SHARDS_MAX-1);
+}
+
+int reserve_shards (sshards * H, unsigned numpages,
+                    double rate, unsigned maxpages)
+{
+    unsigned initial;
+
+    H->numpages = numpages;
+    H->threshold = rate * SHARDS_MAX;
+    H->maxpages = maxpages;
+    H->numheap = 0;
+    H->numcold = H->numsampled = 0;
+    H->numrefs = H->numillegal = 0;
+
+    H->width = (numpages + MRC_BUCKETS-1) / MRC_BUCKETS;
+    H->numbuckets = (numpages + H->width-1) / H->width;
+
+    // The stack grows with a fixed rate; with a fixed size, it
+    // holds one page more than allowed before dropping some
+    initial = maxpages ? maxpages+1 : 1024;
+
+    H->hist = (double*) calloc (H->numbuckets+1, sizeof(double));
+    H->heap = maxpages ? (unsigned*) malloc ((maxpages+1) *
+                                             sizeof(unsigned))
+                       : NULL;
+
+    if (!H->hist || (maxpages && !H->heap) ||
+        stack_init_sparse(&H->K,initial)<0)
+    {
+        free (H->hist);
+        free (H->heap);
+        H->hist = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void free_shards (sshards * H)
+{
+    if (!H->hist)
+        return;
+
+    stack_free (&H->K);
+    free (H->heap);
+    free (H->hist);
+    H->hist = NULL;
+}
+
+// Max-heap of the sampled pages, by hash
+
+static void heap_push (sshards * H, unsigned page)
+{
+    unsigned i, parent;
+
+    for (i=H->numheap++; i>0; i=parent)
+    {
+        parent = (i-1)/2;
+
+        if (page_hash(H->heap[parent]) >= page_hash(page))
+            break;
+
+        H->heap[i] = H->heap[parent];
+    }
+
+    H->heap[i] = page;
+}
+
+static unsigned heap_pop (sshards * H)
+{
+    unsigned top = H->heap[0], last, i, child;
+
+    last = H->heap[--H->numheap];
+
+    for (i=0; (child=2*i+1) < H->numheap; i=child)
+    {
+        if (child+1 < H->numheap &&
+            page_hash(H->heap[child+1]) > page_hash(H->heap[child]))
+            child ++;
+
+        if (page_hash(H->heap[child]) <= page_hash(last))
+            break;
+
+        H->heap[i] = H->heap[child];
+    }
+
+    if (H->numheap)
+        H->heap[i] = last;
+
+    return top;
+}
+
+// Lower the threshold to the largest hash of the sampled
+// pages, drop them, and rescale the histogram
+
+static void lower_threshold (sshards * H)
+{
+    unsigned threshold, b;
+    double scale;
+
+    threshold = page_hash (H->heap[0]);
+
+    while (H->numheap && page_hash(H->heap[0]) >= threshold)
+        stack_remove (&H->K, heap_pop(H));
+
+    scale = threshold / (double) H->threshold;
+
+    for (b=1; b<=H->numbuckets; b++)
+        H->hist[b] *= scale;
+
+    H->numcold *= scale;
+    H->numsampled *= scale;
+    H->threshold = threshold;
+}
+
+static int sample_reference (sshards * H, unsigned page)
+{
+    unsigned dist;
+    double b;
+
+    if (page_hash(page) >= H->threshold)
+        return 0;
+
+    // Room for one more page
+    if (!H->maxpages && H->K.numlive==H->K.numpages &&
+        stack_grow(&H->K,2*H->K.numpages)<0)
+        return -1;
+
+    H->numsampled ++;
+    dist = stack_reference (&H->K, page);
+
+    if (dist==STACK_COLD)
+    {
+        H->numcold ++;
+
+        if (H->maxpages)
+            heap_push (H, page);
+    }
+    else
+    {
+        // Scale the pages referenced in between, not the page
+        // itself, and round the distance up to a bucket
+        b = ceil ((1 + (dist-1) * (double) SHARDS_MAX /
+                       H->threshold) / H->width);
+
+        H->hist[b < H->numbuckets ? (unsigned) b
+                                  : H->numbuckets] ++;
+    }
+
+    if (H->maxpages && H->K.numlive > H->maxpages)
+        lower_threshold (H);
+
+    return 0;
+}
+
+int sampled_distances (strace * T, int pagesz, sshards * H,
+                       sdistances * D)
+{
+    sstack K;
+    unsigned u, page, dist;
+    char op = 0;
+    int ok = 1;
+
+    if (D && stack_init(&K,D->numpages)<0)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    while (ok)
+    {
+        // Read one operation (and the element, if R/W)
+        if (trace_next(T,&op,&u)!=1)
+            break;
+
+        if (op=='R' || op=='W')
+        {
+            H->numrefs ++;
+            page = u / pagesz;
+
+            if (page >= H->numpages)
+            {
+                H->numillegal ++;
+                continue;
+            }
+
+            if (sample_reference(H,page)<0)
+            {
+                fprintf (stderr,
+                         "ERROR: not enough dynamic memory\n");
+                ok = 0;
+            }
+
+            if (!D)
+                continue;
+
+            // Exact distance, for comparison
+            D->numrefs ++;
+            dist = stack_reference (&K, page);
+
+            if (dist==STACK_COLD)
+                D->numcold ++;
+            else
+                D->hist[dist] ++;
+        }
+        else if (op!='C')        // 'S'orted or 'O'ut of order
+            break;
+    }
+
+    if (D)
+        stack_free (&K);
+
+    return ok && op=='S' ? 0 : -1;
+}
+
+// The sampled curve is printed at the end of each bucket where
+// it goes down. With the exact one, the absolute error of the
+// miss ratio is taken at the end of every bucket.
+
+void print_sampled_curve (const sshards * H, const sdistances * D)
+{
+    unsigned long long refs;
+    double expected, missing, missed, ratio, exact, error;
+    double sumerror, maxerror;
+    unsigned long long exactmissed;
+    unsigned b, d, maxbucket;
+
+    refs = H->numrefs - H->numillegal;
+    expected = refs * (H->threshold / (double) SHARDS_MAX);
+
+    // Correction of the sampled references
+    missing = expected - H->numsampled;
+
+    for (b=maxbucket=1; b<=H->numbuckets; b++)
+        if (H->hist[b])
+            maxbucket = b;
+
+    if (D)
+    {
+        for (d=1; d<=D->numpages; d++)
+            if (D->hist[d] && (d+H->width-1)/H->width > maxbucket)
+                maxbucket = (d+H->width-1) / H->width;
+    }
+
+    printf ("# References:  %llu\n"
+            "# Sampling rate:  %g\n"
+            "# Sampled pages:  %u\n"
+            "# Sampled references:  %.0f (expected %.0f)\n",
+            refs, H->threshold / (double) SHARDS_MAX,
+            H->K.numlive, H->numsampled, expected);
+
+    if (D)
+        printf ("#\n#%14s %15s %15s %15s %15s\n#\n",
+                "Frames", "Faults", "Miss ratio", "Exact",
+                "Error");
+    else
+        printf ("#\n#%14s %15s %15s\n#\n",
+                "Frames", "Faults", "Miss ratio");
+
+    missed = expected;
+    exactmissed = D ? D->numrefs : 0;
+    sumerror = maxerror = 0;
+
+    for (b=1, d=1; b<=maxbucket; b++)
+    {
+        missed -= H->hist[b] + (b==1 ? missing : 0);
+        ratio = expected>0 ? missed / expected : 0;
+
+        if (ratio<0)
+            ratio = 0;
+
+        if (D)
+        {
+            for (; d<=b*H->width && d<=D->numpages; d++)
+                exactmissed -= D->hist[d];
+
+            exact = refs ? exactmissed / (double) refs : 0;
+            error = fabs (ratio - exact);
+            sumerror += error;
+
+            if (error > maxerror)
+                maxerror = error;
+        }
+
+        if (b>1 && !H->hist[b])
+            continue;
+
+        if (D)
+            printf (" %14u %15.0f %15f %15f %15f\n",
+                    b*H->width, ratio*refs, ratio, exact, error);
+        else
+            printf (" %14u %15.0f %15f\n",
+                    b*H->width, ratio*refs, ratio);
+    }
+
+    if (D)
+        printf ("#\n# Mean absolute error:  %f\n"
+                "# Max. absolute error:  %f\n",
+                sumerror / maxbucket, maxerror);
+}
+
+// Parallel computation
+
+void * chunk_worker (void * arg)
+{
+    schunk * C = (schunk*) arg;
+    sstack K;
+    unsigned * words;
+    unsigned char * scratch;
+    unsigned long long firstop;
+    unsigned b, page, dist, w;
+    int n, i;
+
+    C->ok = 0;
+    C->end = 0;
+
+    words = (unsigned*) malloc (TZ_BLOCK_OPS*sizeof(unsigned));
+    scratch = (unsigned char*) malloc (TZ_MAX_RAW);
+    C->first = (unsigned*) malloc (C->D.numpages*sizeof(unsigned));
+    C->numfirst = C->numlast = 0;
+
+    if (!words || !scratch || !C->first ||
+        stack_init(&K,C->D.numpages)<0)
+    {
+        free (words);
+        free (scratch);
+        return NULL;
+    }
+
+    for (b=C->firstblock; b<C->endblock && !C->end; b++)
+    {
+        n = trace_read_block (C->T, b, words, scratch, &firstop);
+
+        if (n<0)
+            break;
+
+        for (i=0; i<n; i++)
+        {
+            w = words[i];
+
+            if (w>>30 == TRACE_OP_END)
+            {
+                C->end = w & TRACE_MAX_POS ? 'O' : 'S';
+                break;
+            }
+
+            if (w>>30 == TRACE_OP_CMP)
+                continue;
+
+            C->D.numrefs ++;
+            page = (w & TRACE_MAX_POS) / C->pagesz;
+
+            if (page < C->D.numpages)
+            {
+                dist = stack_reference (&K, page);
+
+                if (dist==STACK_COLD)
+                    C->first[C->numfirst++] = page;
+                else
+                    C->D.hist[dist] ++;
+            }
+            else
+                C->D.numillegal ++;
+        }
+    }
+
+    // The stack holds the pages in order of last reference
+    C->last = (unsigned*) malloc ((K.numlive+1)*sizeof(unsigned));
+
+    if (C->last)
+        C->numlast = stack_pages (&K, C->last);
+
+    stack_free (&K);
+    free (words);
+    free (scratch);
+
+    C->ok = (b==C->endblock || C->end) && C->last;
+
+    return NULL;
+}
+
+int parallel_distances (const strace * T, int pagesz,
+                        int numthreads, sdistances * D)
+{
+    schunk * chunks;
+    pthread_t * threads;
+    unsigned numblocks, page, dist, u;
+    int c, ok;
+    sstack K;
+
+    numblocks = trace_num_blocks (T);
+
+    chunks = (schunk*) calloc (numthreads, sizeof(schunk));
+    threads = (pthread_t*) malloc (numthreads*sizeof(pthread_t));
+    ok = chunks && threads && stack_init(&K,D->numpages)==0;
+
+    // Split the blocks and launch the workers
+
+    for (c=0; ok && c<numthreads; c++)
+    {
+        chunks[c].T = T;
+        chunks[c].pagesz = pagesz;
+        chunks[c].firstblock = (unsigned long long) numblocks*c
+                               / numthreads;
+        chunks[c].endblock = (unsigned long long) numblocks*(c+1)
+                             / numthreads;
+
+        if (reserve_distances(&chunks[c].D,D->numpages)<0)
+            break;
+
+        if (pthread_create(&threads[c],NULL,
+                           chunk_worker,&chunks[c]))
+        {
+            free_distances (&chunks[c].D);
+            break;
+        }
+    }
+
+    ok = ok && c==numthreads;
+    numthreads = c;
+
+    // Wait for them and merge the chunks in order
+
+    for (c=0; c<numthreads; c++)
+    {
+        pthread_join (threads[c], NULL);
+
+        ok = ok && chunks[c].ok;
+
+        for (u=0; ok && u<chunks[c].numfirst; u++)
+        {
+            page = chunks[c].first[u];
+            dist = stack_reference (&K, page);
+
+            if (dist==STACK_COLD)
+                D->numcold ++;
+            else
+                D->hist[dist] ++;
+        }
+
+        for (u=0; ok && u<chunks[c].numlast; u++)
+            stack_reference (&K, chunks[c].last[u]);
+
+        for (u=1; ok && u<=D->numpages; u++)
+            D->hist[u] += chunks[c].D.hist[u];
+
+        D->numrefs += chunks[c].D.numrefs;
+        D->numillegal += chunks[c].D.numillegal;
+
+        // Only the last chunk has the end mark
+        if (c==numthreads-1)
+            ok = ok && chunks[c].end=='S';
+
+        free_distances (&chunks[c].D);
+        free (chunks[c].first);
+        free (chunks[c].last);
+    }
+
+    if (chunks && threads)
+        stack_free (&K);
+
+    free (chunks);
+    free (threads);
+
+    if (!ok)
+        fprintf (stderr, "ERROR: malformed trace or not enough "
+                                "dynamic memory\n");
+
+    return ok ? 0 : -1;
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/" \
+                         "HE4/HE8/HEB/NAT/TIM/BIT/LSD/MSD/CNT/" \
+                         "MMN/MMB/HJN/BTR/BFS"
+#define VALID_INITIAL_ORD "ASC/DES/RAN/NEA/FEW/SAW/ORG/ZIP/RUN/ADV"
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, opt;
+    const char * name = argv[0];
+
+    // Default parameters
+    p->pagesz = 16;
+    p->algorithm = "MER";
+    p->initialorder = "RAN";
+    p->numelem = 1000;
+    p->tracefile = NULL;
+    p->seed = 0;
+    p->numthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    p->rate = 1;
+    p->maxsample = 0;
+    p->exact = 0;
+
+    if (p->numthreads<1)
+        p->numthreads = 1;
+
+    // Options, before the positional parameters
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "f:s:j:r:m:e")) != -1)
+        switch (opt)
+        {
+            case 'f':
+                p->tracefile = optarg;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed");
+                    ok = 0;
+                }
+                break;
+
+            case 'j':
+                if (sscanf(optarg,"%d",&p->numthreads)!=1 ||
+                    p->numthreads<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "threads\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'r':
+                if (sscanf(optarg,"%lf",&p->rate)!=1 ||
+                    p->rate<=0 || p->rate>1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong sampling rate\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'm':
+                if (sscanf(optarg,"%u",&p->maxsample)!=1 ||
+                    p->maxsample<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "sampled pages\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'e':
+                p->exact = 1;
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
+
+    // With a trace file, there is no gen_trace to run
+    if (argc>5 || (p->tracefile && argc>2))
+        ok = 0;
+    else
+    {
+        if (argc>1 && (sscanf(argv[1],"%d",&p->pagesz)!=1 ||
+                       p->pagesz<1))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong page size\n");
+            ok = 0;
+        }
+
+        if (argc>2)
+            p->algorithm = argv[2];
+
+        if (strlen(p->algorithm)!=3 ||
+            strchr(p->algorithm,'/') ||
+            !strstr(VALID_ALGORITHMS,p->algorithm))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong algorithm\n");
+            ok = 0;
+        }
+
+        if (argc>3)
+            p->initialorder = argv[3];
+
+        if (strlen(p->initialorder)!=3 ||
+            strchr(p->initialorder,'/') ||
+            !strstr(VALID_INITIAL_ORD,p->initialorder))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong initial order\n");
+            ok = 0;
+        }
+
+        if (argc>4 && (sscanf(argv[4],"%d",&p->numelem)!=1 ||
+                       p->numelem<2))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong number of "
+                                  "elements\n");
+            ok = 0;
+        }
+    }
+
+    if (ok)
+        return 0;
+
+    fprintf (stderr,
+             "\n    USAGE:\n\t%s [options] [-s seed] pagesz "
+                        "algorithm initialorder numelem\n"
+             "\t%s [options] -f trace pagesz\n\n", name, name);
+
+    fprintf (stderr,
+             "\tpagesz: # of elements that fit in a page\n"
+             "\talgorithm: sorting algorithm or workload (%s)\n"
+             "\tinitialorder: initial order of the array (%s)\n"
+             "\tnumelem: # of elements to be sorted\n"
+             "\ttrace: trace file to replay (text or binary)\n"
+             "\t-j threads: worker threads (# of CPUs); only "
+                          "for binary traces\n"
+             "\t-r rate: sample the pages at this rate (0-1]\n"
+             "\t-m pages: sample at most these pages at once\n"
+             "\t-e: compare the sampled curve with the exact one\n"
+             "\t-s seed: seed of the random order and pivots (0)\n"
+             "\n",
+             VALID_ALGORITHMS, VALID_INITIAL_ORD);
+
+    fprintf (stderr,
+             "    EXAMPLE:\n"
+             "\t%s 16 MER RAN 1000\n"
+             "\n",
+             name);
+
+    return -1;
+}
@@ -5,15 +5,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "trace.h"
+#include "trace_cache.h"
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
 
+#define MAX_SIZES 16   // Max. # of page sizes at once
+
 typedef struct
 {
-    int pagesz, interval;
+    const char * sizes;       // Page sizes, as given
+    int pagesz[MAX_SIZES];    // Page sizes, in elements
+    int numsizes;             //  ... how many
+    int interval;
     const char * algorithm, * initialorder;
     int numelem;
+    const char * tracefile;   // Trace file (NULL = run gen_trace)
+    unsigned seed;            // Seed for gen_trace
 }
 sparameters;
 
@@ -21,8 +33,10 @@ sparameters;
 // command line:
 
 int parse_command (int, char*[], sparameters*);
+int parse_sizes (const char *, sparameters*);
 
-// Structure that maintains the set of referenced pages:
+// Structure that maintains the set of referenced pages,
+// for each page size:
 
 #define NUM_BYTES(BITS) ((BITS+7)>>3)
 #define SET_BIT(P,NBIT) ((P)[(NBIT)>>3] |= 1<<((NBIT)&7))
@@ -33,6 +47,13 @@ typedef struct
     char * prefbits;      // Reference bits of the pages
     int numbytes;         // Size in bytes
     unsigned numpages;    // # of pages (and ref. bits)
+}
+spgset;
+
+typedef struct
+{
+    spgset sets[MAX_SIZES]; // One set per page size
+    int numsets;
     unsigned numrefs;     // # of references in current interval
     unsigned totalrefs;   // Total # of references
     unsigned numillegal;  // # of illegal references
@@ -41,7 +62,8 @@ spgstate;
 
 // Functions that manipulate the referenced pages set
 
-int reserve_bits (spgstate *, int numpages);
+int reserve_bits (spgstate *, const sparameters *,
+                  unsigned totelem);
 void free_bits (spgstate *);
 
 void annotate_reference (const sparameters *,
@@ -49,58 +71,70 @@ void annotate_reference (const sparameters *,
                          unsigned element);
 
 void dump_num_refs (spgstate *);
-void print_header (void);
+void print_header (const sparameters *);
 
 // Main function
 
 int main (int argc, char * argv[])
 {
     sparameters P;      // Parameters received in the command line
-    char command[100];  // Command for executing gen_trace
-    FILE * pipe;        // Communication channel with gen_traza
-    int ok;             // Flag
+    char source[FILENAME_MAX];  // Cached trace (or command)
+    strace T;           // Trace being read
+    int ok, hit;        // Flags
     char op;            // Elementary operation ('R'ead, 'W'ri..)
     unsigned u;         // Number of the read/written element
     spgstate S;         // State of the pages (referenced/not)
-    unsigned numpags;   // Total number of pages
     unsigned totelem;   // Total num. of elements (double in MER)
 
-    S.prefbits = NULL;
+    S.numsets = 0;
 
     if (parse_command(argc,argv,&P)<0)  // Put parameters in P
         return -1;
 
-    printf ("# Parameters:  %s %i %i %s %s %i\n",
-            argv[0], P.pagesz, P.interval,
-            P.algorithm, P.initialorder, P.numelem);
+    if (P.tracefile)
+    {
+        printf ("# Parameters:  %s %s %i\n",
+                argv[0], P.sizes, P.interval);
 
-    // Prepare command for invoking gen_trace
-    // (sprintf "prints" in a string)
-    sprintf (command, "./gen_trace %s %s %u",
-                      P.algorithm, P.initialorder, P.numelem);
+        printf ("# Reading trace:  %s\n", P.tracefile);
 
-    printf ("# Executing command:  %s\n", command);
+        // Map the file in memory and read the total # of
+        // elements
+        if (trace_open_file(&T,P.tracefile)<0)
+        {
+            perror ("ERROR while opening the trace");
+            return -1;
+        }
+    }
+    else
+    {
+        printf ("# Parameters:  %s %s %i %s %s %i\n",
+                argv[0], P.sizes, P.interval,
+                P.algorithm, P.initialorder, P.numelem);
 
-    // Invoke gen_trace and open a pipe to read
-    // its standard output ("r" stands for read)
-    pipe = popen (command, "r");
+        // Take the trace from the cache, or generate it by
+        // invoking gen_trace
+        hit = trace_cache_open (&T, P.algorithm, P.initialorder,
+                                P.numelem, P.seed,
+                                source, sizeof(source));
 
-    if (!pipe)
-    {
-        perror ("ERROR while starting gen_trace");
-        return -1;
+        if (hit<0)
+        {
+            perror ("ERROR while starting gen_trace");
+            return -1;
+        }
+
+        printf ("# Trace:  %s (%s)\n", source,
+                hit ? "cached" : "generated");
     }
 
-    // Read total # of elements to be sorted
-    ok = fscanf (pipe," T %u", &totelem) == 1;
+    totelem = T.totelem;
+    ok = totelem > 0;
 
     if (ok)
     {
-        // Calculate total number of pages
-        numpags = (totelem+P.pagesz-1) / P.pagesz; 
-
         // Reserve space for the reference bits
-        if (reserve_bits(&S,numpags)<0)
+        if (reserve_bits(&S,&P,totelem)<0)
         {
             fprintf (stderr,
                      "ERROR: not enough "
@@ -110,24 +144,19 @@ int main (int argc, char * argv[])
     }
 
     if (ok)
-        print_header ();
+        print_header (&P);
 
     while (ok)
     {
-        // Ignore spaces and read one character
-        if (fscanf(pipe," %c",&op)!=1)
+        // Read one operation (and the element, if R/W)
+        if (trace_next(&T,&op,&u)!=1)
         {
             ok = 0;
             break;
         }
 
         if (op=='R' || op=='W')              // If R/W,
-        {                                    // take element
-            if (fscanf(pipe,"%u",&u)!=1)     // number and
-                ok = 0;                      // annotate
-            else
-                annotate_reference (&P, &S, u);
-        }
+            annotate_reference (&P, &S, u);  // annotate
         else if (op=='S')        // 'S'orted -> end
             break;               // 'C'omparison -> go on
         else if (op!='C')        // 'O'ut of order (or
@@ -144,7 +173,7 @@ int main (int argc, char * argv[])
     }
 
     // Wait until gen_trace ends and close
-    if (pclose(pipe)==-1)
+    if (trace_close(&T)<0)
         ok = 0;
 
     free_bits (&S);
@@ -154,26 +183,49 @@ int main (int argc, char * argv[])
 
 // Functions that manipulate the referenced pages set
 
-int reserve_bits (spgstate * pS, int numpages)
+int reserve_bits (spgstate * pS, const sparameters * pPar,
+                  unsigned totelem)
 {
-    pS->numpages = numpages;
-    pS->numbytes = NUM_BYTES (numpages);
+    spgset * set;
+    int i;
+
+    pS->numsets = pPar->numsizes;
     pS->numrefs = pS->totalrefs = pS->numillegal = 0;
-    pS->prefbits = (char*) malloc (pS->numbytes);
 
-    if (pS->prefbits)
+    for (i=0; i<pS->numsets; i++)
+        pS->sets[i].prefbits = NULL;
+
+    for (i=0; i<pS->numsets; i++)
     {
-        memset (pS->prefbits, 0, pS->numbytes);
-        return 0;
+        set = &pS->sets[i];
+
+        // Calculate total number of pages
+        set->numpages = (totelem+pPar->pagesz[i]-1) /
+                        pPar->pagesz[i];
+        set->numbytes = NUM_BYTES (set->numpages);
+        set->prefbits = (char*) malloc (set->numbytes);
+
+        if (!set->prefbits)
+        {
+            free_bits (pS);
+            return -1;
+        }
+
+        memset (set->prefbits, 0, set->numbytes);
     }
 
-    return -1;
+    return 0;
 }
 
 void free_bits (spgstate * pS)
 {
-    free (pS->prefbits);
-    pS->prefbits = NULL;
+    int i;
+
+    for (i=0; i<pS->numsets; i++)
+    {
+        free (pS->sets[i].prefbits);
+        pS->sets[i].prefbits = NULL;
+    }
 }
 
 void annotate_reference (const sparameters * pPar,
@@ -181,42 +233,75 @@ void annotate_reference (const sparameters * pPar,
                          unsigned element)
 {
     unsigned page;
+    int i;
 
-    page = element / pPar->pagesz;
+    // Out of range for one page size, out of range for all
+    for (i=0; i<pS->numsets; i++)
+        if (element / pPar->pagesz[i] >= pS->sets[i].numpages)
+        {
+            pS->numillegal ++;
+            return;
+        }
 
-    if (page < pS->numpages)
+    for (i=0; i<pS->numsets; i++)
     {
-        SET_BIT (pS->prefbits, page);
-
-        if (++pS->numrefs >= pPar->interval)
-            dump_num_refs (pS);
+        page = element / pPar->pagesz[i];
+        SET_BIT (pS->sets[i].prefbits, page);
     }
-    else
-        pS->numillegal ++;
+
+    if (++pS->numrefs >= pPar->interval)
+        dump_num_refs (pS);
 }
 
-void print_header (void)
+// With one page size, the table has the pages and the pages
+// per operation; with several, a pair of columns per size
+
+void print_header (const sparameters * pPar)
 {
-    printf ("#\n#%18s %15s %15s %15s\n#\n",
-            "Position", "Interval", "Pages", "Pages/op.");
+    char pages[32], perop[32];
+    int i;
+
+    printf ("#\n#%18s %15s", "Position", "Interval");
+
+    if (pPar->numsizes==1)
+        printf (" %15s %15s", "Pages", "Pages/op.");
+    else
+        for (i=0; i<pPar->numsizes; i++)
+        {
+            sprintf (pages, "Pages(%d)", pPar->pagesz[i]);
+            sprintf (perop, "/op.(%d)", pPar->pagesz[i]);
+            printf (" %15s %15s", pages, perop);
+        }
+
+    printf ("\n#\n");
 }
 
 void dump_num_refs (spgstate * pS)
 {
     unsigned u, refs;
+    spgset * set;
+    int i;
 
     if (!pS->numrefs)
         return;
 
-    for (u=refs=0; u<pS->numpages; u++)
-        if (GET_BIT(pS->prefbits, u))
-            refs ++;
+    printf (" %15u %15u", pS->totalrefs, pS->numrefs);
+
+    for (i=0; i<pS->numsets; i++)
+    {
+        set = &pS->sets[i];
+
+        for (u=refs=0; u<set->numpages; u++)
+            if (GET_BIT(set->prefbits, u))
+                refs ++;
+
+        printf (" %15u %15f", refs, refs/(float)pS->numrefs);
+
+        memset (set->prefbits, 0, set->numbytes);
+    }
 
-    printf (" %15u %15u %15u %15f\n",
-            pS->totalrefs, pS->numrefs,
-            refs, refs/(float)pS->numrefs);
+    printf ("\n");
 
-    memset (pS->prefbits, 0, pS->numbytes);
     pS->totalrefs += pS->numrefs;
     pS->numrefs = 0;
 }
@@ -224,28 +309,61 @@ void dump_num_refs (spgstate * pS)
 // Function that parses the parameters received through the
 // command line:
 
-#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
-#define VALID_INITIAL_ORD "ASC/DES/RAN"
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/" \
+                         "HE4/HE8/HEB/NAT/TIM/BIT/LSD/MSD/CNT/" \
+                         "MMN/MMB/HJN/BTR/BFS"
+#define VALID_INITIAL_ORD "ASC/DES/RAN/NEA/FEW/SAW/ORG/ZIP/RUN/ADV"
 
 int parse_command (int argc, char * argv[], sparameters * p)
 {
-    int ok;
+    int ok, opt;
+    const char * name = argv[0];
 
     // Default parameters
-    p->pagesz = 16;
+    p->sizes = "16";
+    p->pagesz[0] = 16;
+    p->numsizes = 1;
     p->interval = 2000;
     p->algorithm = "MER";
     p->initialorder = "RAN";
     p->numelem = 1000;
+    p->tracefile = NULL;
+    p->seed = 0;
 
-    if (argc>6)
+    // Options, before the positional parameters
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "f:s:")) != -1)
+        switch (opt)
+        {
+            case 'f':
+                p->tracefile = optarg;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
+
+    // With a trace file, there is no gen_trace to run
+    if (argc>6 || (p->tracefile && argc>3))
         ok = 0;
     else
     {
-        ok = 1;
-
-        if (argc>1 && (sscanf(argv[1],"%d",&p->pagesz)!=1 ||
-                       p->pagesz<1))
+        if (argc>1 && parse_sizes(argv[1],p)<0)
         {
             fprintf (stderr,
                      "\n    ERROR: wrong page size\n");
@@ -298,25 +416,55 @@ int parse_command (int argc, char * argv[], sparameters * p)
         return 0;
 
     fprintf (stderr,
-             "\n    USAGE:\n\t%s pagesz interval algorithm "
-                        "initialorder numelem\n\n", argv[0]);
+             "\n    USAGE:\n\t%s [-s seed] pagesz interval algorithm "
+                        "initialorder numelem\n"
+             "\t%s -f trace pagesz interval\n\n", name, name);
 
     fprintf (stderr,
-             "\tpagesz: nº de elementos que caben "
-                       "en una página\n"
+             "\tpagesz: # of elements that fit in a page, or a\n"
+             "\t        list of sizes separated by commas (up to %d)\n"
              "\tinterval: # of operations per interval\n"
-             "\talgorithm: sorting algorithm (%s)\n"
+             "\talgorithm: sorting algorithm or workload (%s)\n"
              "\tinitialorder: initial order of the array (%s)\n"
              "\tnumelem: # of elements to be sorted\n"
+             "\ttrace: trace file to replay (text or binary)\n"
+             "\t-s seed: seed of the random order and pivots (0)\n"
              "\n",
-             VALID_ALGORITHMS, VALID_INITIAL_ORD);
+             MAX_SIZES, VALID_ALGORITHMS, VALID_INITIAL_ORD);
 
     fprintf (stderr,
-             "    EXAMPLE:\n"
+             "    EXAMPLES:\n"
              "\t%s 16 2000 MER RAN 1000\n"
+             "\t%s 4,16,64,256 2000 MER RAN 1000\n"
              "\n",
-             argv[0]);
+             name, name);
 
     return -1;
 }
 
+// Parse a list of page sizes separated by commas
+
+int parse_sizes (const char * list, sparameters * p)
+{
+    const char * s = list;
+    char * end;
+    long size;
+
+    p->sizes = list;
+    p->numsizes = 0;
+
+    do
+    {
+        size = strtol (s, &end, 10);
+
+        if (end==s || size<1 || size>INT_MAX ||
+            p->numsizes==MAX_SIZES)
+            return -1;
+
+        p->pagesz[p->numsizes++] = size;
+        s = end+1;
+    }
+    while (*end==',');
+
+    return *end ? -1 : 0;
+}
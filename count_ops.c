@@ -4,12 +4,460 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "trace.h"
+#include "trace_cache.h"
 
 #define NUM_ALG 8
 #define NUM_INI 3
 #define NUM_SZS 3
 
-int main ()
+// One experiment: an algorithm, an initial state and a size
+
+typedef struct
+{
+    const char * algorithm;
+    const char * initial;
+    unsigned size;
+    unsigned long long reads, writes, comparisons;
+    double seconds;    // Wall clock time
+    int ok;            // 0 if an error occurred
+}
+scell;
+
+// The experiments, shared by the threads, which take the next
+// one to do until there are none left
+
+typedef struct
+{
+    scell * cells;
+    int numcells;
+    int next;          // Next cell to do
+    int traces;        // 1 = count the traces, 0 = gen_trace -c
+    unsigned seed;
+    pthread_mutex_t lock;
+}
+spool;
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    const char * algorithms[NUM_ALG*4];
+    const char * initial[NUM_INI*4];
+    unsigned sizes[NUM_SZS*8];
+    int numalg, numini, numszs;
+    unsigned seed;
+    int numthreads;
+    int traces;        // Count the traces instead (-T)
+    const char * csvfile;
+}
+sparameters;
+
+// Function that counts the operations of a trace
+
+int count_operations (strace * T, unsigned long long * reads,
+                      unsigned long long * writes,
+                      unsigned long long * comparisons);
+
+int count_files (int numfiles, char * files[]);
+
+void * cell_worker (void * p);
+
+int parse_command (int argc, char * argv[], sparameters * p);
+
+static double now (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+// The largest sizes first, so that the longest experiments do
+// not start last
+
+static int compare_cells (const void * a, const void * b)
+{
+    const scell * x = a, * y = b;
+
+    return x->size < y->size ? 1 : x->size > y->size ? -1 : 0;
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;     // Parameters
+    spool Q;           // Experiments to do
+    pthread_t * threads;
+    scell * cell;
+    FILE * csv;
+    double start, elapsed;
+    unsigned long long total;
+    int a, i, t, c, n, ok;
+
+    if (parse_command(argc,argv,&P)<0)
+        return -1;
+
+    // If trace files are given, count their operations
+    // instead of running the experiments
+
+    if (optind<argc)
+        return count_files (argc-optind, argv+optind);
+
+    Q.numcells = P.numalg * P.numini * P.numszs;
+    Q.cells = (scell*) calloc (Q.numcells, sizeof(scell));
+    Q.next = 0;
+    Q.traces = P.traces;
+    Q.seed = P.seed;
+    pthread_mutex_init (&Q.lock, NULL);
+
+    if (P.numthreads > Q.numcells)
+        P.numthreads = Q.numcells;
+
+    threads = (pthread_t*) malloc (P.numthreads*sizeof(pthread_t));
+
+    if (!Q.cells || !threads)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (c=0, t=0; t<P.numszs; t++)
+        for (a=0; a<P.numalg; a++)
+            for (i=0; i<P.numini; i++, c++)
+            {
+                Q.cells[c].algorithm = P.algorithms[a];
+                Q.cells[c].initial = P.initial[i];
+                Q.cells[c].size = P.sizes[t];
+            }
+
+    qsort (Q.cells, Q.numcells, sizeof(scell), compare_cells);
+
+    // Carry out experiments and fill results tables
+
+    start = now ();
+
+    for (n=0; n<P.numthreads; n++)
+        if (pthread_create(&threads[n],NULL,cell_worker,&Q))
+            break;
+
+    if (!n)
+    {
+        perror ("ERROR creating the threads");
+        return -1;
+    }
+
+    for (t=0; t<n; t++)
+        pthread_join (threads[t], NULL);
+
+    elapsed = now () - start;
+
+    // Print tables (0 if an error occurred)
+
+    for (i=0; i<P.numini; i++)
+    {
+        printf ("\n\nInitial state: %s\n", P.initial[i]);
+        printf ("===================\n%-8s", "Size");
+
+        for (a=0; a<P.numalg; a++)
+            printf ("%8s", P.algorithms[a]);
+
+        printf ("\n\n");
+
+        for (t=0; t<P.numszs; t++)
+        {
+            printf ("%-8u", P.sizes[t]);
+
+            for (a=0; a<P.numalg; a++)
+            {
+                for (c=0; c<Q.numcells; c++)
+                    if (Q.cells[c].algorithm==P.algorithms[a] &&
+                        Q.cells[c].initial==P.initial[i] &&
+                        Q.cells[c].size==P.sizes[t])
+                        break;
+
+                cell = &Q.cells[c];
+                total = cell->ok ? cell->reads + cell->writes +
+                                   cell->comparisons : 0;
+
+                if (total<1000000)
+                    printf (" %7llu", total);
+                else
+                    printf (" %7.1e", (double) total);
+            }
+
+            printf ("\n");
+        }
+    }
+
+    printf ("\n%d experiments in %.3f s with %d threads\n",
+            Q.numcells, elapsed, P.numthreads);
+
+    // All the counters, in the order of the tables
+
+    ok = 1;
+
+    if (P.csvfile)
+    {
+        csv = fopen (P.csvfile, "w");
+
+        if (!csv)
+        {
+            perror (P.csvfile);
+            ok = 0;
+        }
+        else
+        {
+            fprintf (csv, "algorithm,initial,size,reads,writes,"
+                          "comparisons,total,seconds\n");
+
+            for (t=0; t<P.numszs; t++)
+                for (a=0; a<P.numalg; a++)
+                    for (i=0; i<P.numini; i++)
+                        for (c=0; c<Q.numcells; c++)
+                        {
+                            cell = &Q.cells[c];
+
+                            if (cell->ok &&
+                                cell->algorithm==P.algorithms[a] &&
+                                cell->initial==P.initial[i] &&
+                                cell->size==P.sizes[t])
+                                fprintf (csv, "%s,%s,%u,%llu,%llu,"
+                                              "%llu,%llu,%.6f\n",
+                                         cell->algorithm,
+                                         cell->initial, cell->size,
+                                         cell->reads, cell->writes,
+                                         cell->comparisons,
+                                         cell->reads+cell->writes+
+                                         cell->comparisons,
+                                         cell->seconds);
+                        }
+
+            if (fclose(csv))
+                ok = 0;
+        }
+    }
+
+    for (c=0; c<Q.numcells; c++)
+        ok = ok && Q.cells[c].ok;
+
+    pthread_mutex_destroy (&Q.lock);
+    free (Q.cells);
+    free (threads);
+
+    return ok ? 0 : -1;
+}
+
+// Count the operations of one experiment without trace: gen_trace
+// -c only prints the counters
+
+static int count_cell (scell * cell, unsigned seed)
+{
+    char command[FILENAME_MAX];
+    char result[16];
+    FILE * pipe;
+    int ok;
+
+    snprintf (command, sizeof(command),
+              "./gen_trace -c -s %u %s %s %u", seed,
+              cell->algorithm, cell->initial, cell->size);
+
+    pipe = popen (command, "r");
+
+    if (!pipe)
+        return 0;
+
+    ok = fscanf (pipe, "Reads: %llu Writes: %llu Comparisons: %llu "
+                       "%15s", &cell->reads, &cell->writes,
+                 &cell->comparisons, result) == 4 &&
+         !strcmp (result, "Sorted");
+
+    return pclose (pipe)==0 && ok;
+}
+
+// Count the operations of one experiment through its trace (from
+// the cache, or generated by gen_trace)
+
+static int count_trace (spool * Q, scell * cell)
+{
+    char source[FILENAME_MAX]; // Cached trace (or command)
+    strace T;          // Trace being read
+    int ok;
+
+    ok = trace_cache_open (&T, cell->algorithm, cell->initial,
+                           cell->size, Q->seed, source,
+                           sizeof(source));
+
+    if (ok<0)
+        return 0;
+
+    pthread_mutex_lock (&Q->lock);
+    printf ("Trace: %s (%s)\n", source, ok ? "cached" : "generated");
+    pthread_mutex_unlock (&Q->lock);
+
+    // Read (and ignore) size, and count
+    ok = count_operations (&T, &cell->reads, &cell->writes,
+                           &cell->comparisons);
+
+    // Wait until gen_trace ends and close
+    if (trace_close(&T)<0)
+        ok = 0;
+
+    return ok;
+}
+
+void * cell_worker (void * p)
+{
+    spool * Q = (spool*) p;
+    scell * cell;
+    double start;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&Q->lock);
+        cell = Q->next < Q->numcells ? &Q->cells[Q->next++] : NULL;
+        pthread_mutex_unlock (&Q->lock);
+
+        if (!cell)
+            return NULL;
+
+        start = now ();
+        cell->ok = Q->traces ? count_trace (Q, cell)
+                             : count_cell (cell, Q->seed);
+        cell->seconds = now () - start;
+
+        pthread_mutex_lock (&Q->lock);
+
+        if (cell->ok)
+            printf ("Counted: %s %s %u (%.3f s)\n", cell->algorithm,
+                    cell->initial, cell->size, cell->seconds);
+        else
+            fprintf (stderr, "ERROR counting %s %s %u\n",
+                     cell->algorithm, cell->initial, cell->size);
+
+        fflush (stdout);
+        pthread_mutex_unlock (&Q->lock);
+    }
+}
+
+// Function that counts the operations of a trace
+
+int count_operations (strace * T, unsigned long long * reads,
+                      unsigned long long * writes,
+                      unsigned long long * comparisons)
+{
+    char op;           // Elementary operation ('R'ead, 'W'rite...)
+    unsigned u;        // Number of read/written element
+
+    *reads = *writes = *comparisons = 0;
+
+    for (;;)
+    {
+        // Read one operation (and the element, if R/W)
+        if (trace_next(T,&op,&u)!=1)
+            return 0;
+
+        if (op=='R')                 // If it's a read
+            (*reads) ++;             // or a write,
+        else if (op=='W')            // count it
+            (*writes) ++;
+        else if (op=='C')            // 'C'omparison
+            (*comparisons) ++;
+        else if (op=='S')            // 'S'orted (end)
+            return 1;
+        else                         // 'O'ut of order (or
+            return 0;                // sth. else) -> error
+    }
+}
+
+// Function that counts the operations of trace files
+
+int count_files (int numfiles, char * files[])
+{
+    strace T;
+    unsigned long long reads, writes, comparisons;
+    int f, ok, allok;
+
+    printf ("%-30s %12s %12s %12s %12s\n", "Trace",
+            "Reads", "Writes", "Comparisons", "Total");
+
+    for (f=0, allok=1; f<numfiles; f++)
+    {
+        // Map the file in memory and read the size
+        if (trace_open_file(&T,files[f])<0)
+        {
+            perror (files[f]);
+            allok = 0;
+            continue;
+        }
+
+        ok = count_operations (&T, &reads, &writes, &comparisons);
+        trace_close (&T);
+
+        if (ok)
+            printf ("%-30s %12llu %12llu %12llu %12llu\n", files[f],
+                    reads, writes, comparisons,
+                    reads+writes+comparisons);
+        else
+        {
+            fprintf (stderr, "%s: wrong trace\n", files[f]);
+            allok = 0;
+        }
+    }
+
+    return allok ? 0 : -1;
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/" \
+                         "HE4/HE8/HEB/NAT/TIM/BIT/LSD/MSD/CNT/" \
+                         "MMN/MMB/HJN/BTR/BFS"
+#define VALID_INITIAL_ORD "ASC/DES/RAN/NEA/FEW/SAW/ORG/ZIP/RUN/ADV"
+
+// Split a list separated by commas (in place); each name must be
+// one of 'valid'. Return the number of items, or -1.
+
+static int parse_names (char * list, const char * valid,
+                        const char * names[], int maxnames)
+{
+    char * name;
+    int n;
+
+    for (n=0, name=strtok(list,","); name; name=strtok(NULL,","))
+    {
+        if (n==maxnames || strlen(name)!=3 || strchr(name,'/') ||
+            !strstr(valid,name))
+            return -1;
+
+        names[n++] = name;
+    }
+
+    return n ? n : -1;
+}
+
+static int parse_sizes (char * list, unsigned sizes[], int maxsizes)
+{
+    char * size;
+    int n;
+
+    for (n=0, size=strtok(list,","); size; size=strtok(NULL,","))
+        if (n==maxsizes || sscanf(size,"%u",&sizes[n])!=1 ||
+            sizes[n++]<2)
+            return -1;
+
+    return n ? n : -1;
+}
+
+int parse_command (int argc, char * argv[], sparameters * p)
 {
     // Initial states of the array: ASCending order,
     // DEScending order and RANdom order (or rather disorder)
@@ -24,112 +472,119 @@ int main ()
     const char * algorithms[NUM_ALG] = { "BUB", "INS", "SEL",
                                          "HEA", "COM", "MER",
                                          "QUI", "QRP" };
+    int ok, opt;
+    const char * name = argv[0];
 
-    char command[100]; // Command for executing gen_trace
-    FILE * pipe;       // Channel for communicating with gen_trace
-    int a, i, t, ok;   // Array indexes and flag
-    char op;           // Elementary operation ('R'ead, 'W'rite...)
-    unsigned u;        // Number of read/written element
-    unsigned sz;       // Size of the array to sort
-
-    unsigned reads, writes, comparisons;            // Counters
-    unsigned results[NUM_ALG][NUM_INI][NUM_SZS];    // Tables
+    // Default parameters
+    memcpy (p->algorithms, algorithms, sizeof(algorithms));
+    memcpy (p->initial, initial, sizeof(initial));
+    memcpy (p->sizes, sizes, sizeof(sizes));
+    p->numalg = NUM_ALG;
+    p->numini = NUM_INI;
+    p->numszs = NUM_SZS;
+    p->seed = 0;
+    p->numthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    p->traces = 0;
+    p->csvfile = NULL;
 
-    // Carry out experiments and fill results tables
-
-    for (t=0; t<NUM_SZS; t++)
-        for (a=0; a<NUM_ALG; a++)
-            for (i=0; i<NUM_INI; i++)
-            {
-                sz = sizes[t];
-                reads = writes = comparisons = 0;
+    if (p->numthreads<1)
+        p->numthreads = 1;
 
-                // Make command to invoke gen_trace
-                // (sprintf "prints" in a string)
-                sprintf (command, "./gen_trace %s %s %u",
-                                  algorithms[a], initial[i], sz);
+    // Options, before the trace files
 
-                printf ("Executing command: %s\n", command);
+    ok = 1;
 
-                // Invoke gen_trace and open pipe for reading
-                // its standard output ("r" stands for read)
-                pipe = popen (command, "r");
-
-                if (!pipe)
+    while ((opt = getopt(argc, argv, "a:i:n:s:j:o:T")) != -1)
+        switch (opt)
+        {
+            case 'a':
+                p->numalg = parse_names (optarg, VALID_ALGORITHMS,
+                                         p->algorithms,
+                                         NUM_ALG*4);
+                if (p->numalg<0)
                 {
-                    perror ("ERROR starting gen_trace");
-                    return -1;
+                    fprintf (stderr,
+                             "\n    ERROR: wrong algorithms\n");
+                    ok = 0;
                 }
+                break;
 
-                // Read (and ignore) size
-                ok = fscanf (pipe," T %u", &u) == 1;
-
-                while (ok)
+            case 'i':
+                p->numini = parse_names (optarg, VALID_INITIAL_ORD,
+                                         p->initial, NUM_INI*4);
+                if (p->numini<0)
                 {
-                    // Ignore spaces and read one character
-                    if (fscanf(pipe," %c",&op)!=1)
-                    {
-                        ok = 0;
-                        break;
-                    }
-
-                    if (op=='R' || op=='W')  // If it's a read
-                    {                        // or a write,
-                        if (op=='R')         // count it and read
-                            reads ++;        // the number of the
-                        else                 // referenced
-                            writes ++;       // element (u)
-
-                        if (fscanf(pipe,"%u",&u)!=1)
-                            ok = 0;
-                    }
-                    else if (op=='C')        // 'C'omparison
-                        comparisons ++;
-                    else if (op=='S')        // 'S'orted (end)
-                        break;
-                    else                     // 'O'ut of order (or
-                        ok = 0;              // sth. else) -> error
+                    fprintf (stderr,
+                             "\n    ERROR: wrong initial orders\n");
+                    ok = 0;
                 }
+                break;
 
-                // Wait until gen_trace ends and close
-                if (pclose(pipe)==-1)
+            case 'n':
+                p->numszs = parse_sizes (optarg, p->sizes,
+                                         NUM_SZS*8);
+                if (p->numszs<0)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong sizes\n");
                     ok = 0;
+                }
+                break;
 
-                // Store number of operations in the table
-                // (0 if an error occurred)
-                results[a][i][t] = ok ? reads +
-                                        writes +
-                                        comparisons : 0;
-            }
-
-    // Print tables
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed\n");
+                    ok = 0;
+                }
+                break;
 
-    for (i=0; i<NUM_INI; i++)
-    {
-        printf ("\n\nInitial state: %s\n", initial[i]);
-        printf ("===================\nSize");
+            case 'j':
+                if (sscanf(optarg,"%d",&p->numthreads)!=1 ||
+                    p->numthreads<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "threads\n");
+                    ok = 0;
+                }
+                break;
 
-        for (a=0; a<NUM_ALG; a++)
-            printf ("%8s", algorithms[a]);
+            case 'o':
+                p->csvfile = optarg;
+                break;
 
-        printf ("\n\n");
+            case 'T':
+                p->traces = 1;
+                break;
 
-        for (t=0; t<NUM_SZS; t++)
-        {
-            printf ("%6u", sizes[t]);
+            default:
+                ok = 0;
+        }
 
-            for (a=0; a<NUM_ALG; a++)
-                if (results[a][i][t]<1000000)
-                    printf (" %7u", results[a][i][t]);
-                else
-                    printf (" %7.1e", (float)results[a][i][t]);
+    if (!ok)
+    {
+        fprintf (stderr,
+             "\n    Use: %s [options] [trace_file...]\n\n"
+             "\tWithout trace files, count the operations of each\n"
+             "\talgorithm with each initial order and size:\n\n"
+             "\t-a algs: algorithms, separated by commas, among\n"
+             "\t         %s\n"
+             "\t         (the sorting ones)\n"
+             "\t-i ords: initial orders, among %s\n"
+             "\t         (ASC,DES,RAN)\n"
+             "\t-n sizes: sizes of the array (10,100,1000)\n"
+             "\t-s seed: seed of the random order and pivots (0)\n"
+             "\t-j threads: experiments at a time (one per CPU)\n"
+             "\t-o file: write all the counters to a CSV file\n"
+             "\t-T: count the operations of the traces (slower,\n"
+             "\t    but cached) instead of running gen_trace -c\n\n"
+             "\tExample: %s -a HEA,MER,QRP -n 1000000 -o ops.csv\n\n",
+             name, VALID_ALGORITHMS, VALID_INITIAL_ORD, name);
 
-            printf ("\n");
-        }
+        return -1;
     }
 
-    printf ("\n");
-
     return 0;
 }
-
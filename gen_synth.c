@@ -0,0 +1,545 @@
+/*
+    gen_synth.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "trace.h"
+#include "alias.h"
+#include "stack_dist.h"
+
+// Synthetic traces, drawn from models of locality instead of
+// running a program:
+//
+// IRM: independent reference model. Each reference is to the
+//      object i with a probability proportional to
+//      1/(i+1)^alpha (Zipf), whatever the previous ones were.
+// LRU: LRU stack model. Each reference is to the object at a
+//      stack distance drawn from a given distribution, which
+//      then goes to the top of the stack: with F frames, LRU
+//      fails on the references at distances over F, so the
+//      distribution is the miss ratio curve.
+// PHA: phase model. The references are drawn as in IRM from
+//      one of several working sets, for a number of references
+//      of geometric distribution, and then switch to another
+//      one at random.
+//
+// Each reference is drawn in O(1) with alias tables, except
+// for the stack of LRU, which takes O(log objects). The trace
+// has the format of gen_trace, and each object takes 'unit'
+// elements, one of which is accessed at random.
+
+#define MODEL_IRM 0
+#define MODEL_LRU 1
+#define MODEL_PHA 2
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int model;
+    unsigned numobjects;
+    unsigned long long numrefs;
+    double alpha;          // Zipf exponent
+    const char * distfile; // Distances of LRU (NULL = Zipf)
+    unsigned numsets;      // Working sets of PHA
+    unsigned setsize;      //  ... objects in each one
+    double phaselen;       //  ... mean references in each
+    unsigned unit;         // Elements per object
+    double writes;         // Fraction of writes
+    unsigned seed;
+    int format;            // TRACE_TEXT, TRACE_BINARY or TRACE_BLOCKS
+}
+sparameters;
+
+int parse_command (int, char *[], sparameters *);
+
+// Random numbers (xorshift64*), seeded with splitmix64
+
+static unsigned long long state;
+
+static void seed_random (unsigned seed)
+{
+    unsigned long long z = seed + 0x9e3779b97f4a7c15ULL;
+
+    z = (z ^ (z>>30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z>>27)) * 0x94d049bb133111ebULL;
+    state = (z ^ (z>>31)) | 1;
+}
+
+static unsigned long long next_random (void)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+
+    return state * 2685821657736338717ULL;
+}
+
+// Uniform in [0,1)
+
+static double uniform (void)
+{
+    return (next_random() >> 11) * (1.0/9007199254740992.0);
+}
+
+// Write the reference to the object. Return -1 if the trace
+// could not be written.
+
+static unsigned long long writelimit;   // writes * 2^64
+
+static int reference (stracewriter * W, const sparameters * P,
+                      unsigned object)
+{
+    unsigned pos = object * P->unit;
+
+    if (P->unit>1)
+        pos += next_random () % P->unit;
+
+    return trace_write_op (W, next_random()<writelimit ? 'W' : 'R',
+                           pos);
+}
+
+// Distribution of the distances of LRU: weights[d] for distance
+// d, and weights[0] for the first references to new objects
+
+static int read_distances (const char * path, double * weights,
+                           unsigned maxdist)
+{
+    char line[256];
+    unsigned d;
+    double w, sum = 0;
+    int n, ok = 1;
+    FILE * pf;
+
+    pf = fopen (path, "r");
+
+    if (!pf)
+    {
+        perror (path);
+        return -1;
+    }
+
+    // Lines "distance weight" (0 = new object), and comments
+    while (ok && fgets(line,sizeof(line),pf))
+    {
+        n = sscanf (line, "%u %lf", &d, &w);
+
+        if (line[0]=='#' || n==EOF)
+            continue;
+
+        if (n!=2 || d>maxdist || w<0)
+            ok = 0;
+        else
+        {
+            weights[d] += w;
+            sum += w;
+        }
+    }
+
+    fclose (pf);
+
+    if (!ok || sum<=0)
+    {
+        fprintf (stderr, "ERROR: wrong distances in %s (up to "
+                         "%u)\n", path, maxdist);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int irm (stracewriter * W, const sparameters * P)
+{
+    double * weights;
+    salias A;
+    unsigned long long r;
+    int ok = 1;
+
+    weights = (double*) malloc (P->numobjects*sizeof(double));
+
+    if (!weights)
+        return -1;
+
+    zipf_weights (weights, P->numobjects, P->alpha);
+
+    if (alias_init(&A,weights,P->numobjects)<0)
+    {
+        free (weights);
+        return -1;
+    }
+
+    free (weights);
+
+    for (r=0; r<P->numrefs && ok; r++)
+        ok = reference (W, P, alias_draw(&A,next_random())) == 0;
+
+    alias_free (&A);
+    return ok ? 0 : -1;
+}
+
+static int lru (stracewriter * W, const sparameters * P)
+{
+    double * weights;
+    salias A;
+    sstack K;
+    unsigned long long r;
+    unsigned d, object, numnew = 0;
+    int ok;
+
+    weights = (double*) calloc (P->numobjects+1, sizeof(double));
+
+    if (!weights)
+        return -1;
+
+    if (P->distfile)
+        ok = read_distances (P->distfile, weights,
+                             P->numobjects) == 0;
+    else
+    {
+        zipf_weights (weights+1, P->numobjects, P->alpha);
+        ok = 1;
+    }
+
+    if (!ok || alias_init(&A,weights,P->numobjects+1)<0)
+    {
+        free (weights);
+        return -1;
+    }
+
+    free (weights);
+
+    if (stack_init(&K,P->numobjects)<0)
+    {
+        alias_free (&A);
+        return -1;
+    }
+
+    for (r=0; r<P->numrefs && ok; r++)
+    {
+        d = alias_draw (&A, next_random());
+
+        // Deeper than the stack: a new object, or else the
+        // least recently used
+        if (d==0 || d>K.numlive)
+            object = numnew<P->numobjects ? numnew++
+                                          : stack_page_at (&K,
+                                                           K.numlive);
+        else
+            object = stack_page_at (&K, d);
+
+        stack_reference (&K, object);
+        ok = reference (W, P, object) == 0;
+    }
+
+    stack_free (&K);
+    alias_free (&A);
+    return ok ? 0 : -1;
+}
+
+static int phases (stracewriter * W, const sparameters * P)
+{
+    double * weights;
+    unsigned * sets, * perm, s, u, v, tmp, set = 0;
+    unsigned long long r, left = 0;
+    salias A;
+    int ok;
+
+    weights = (double*) malloc (P->setsize*sizeof(double));
+    sets = (unsigned*) malloc ((unsigned long long) P->numsets *
+                               P->setsize * sizeof(unsigned));
+    perm = (unsigned*) malloc (P->numobjects*sizeof(unsigned));
+
+    ok = weights && sets && perm;
+
+    if (ok)
+    {
+        zipf_weights (weights, P->setsize, P->alpha);
+        ok = alias_init (&A, weights, P->setsize) == 0;
+    }
+
+    free (weights);
+
+    if (!ok)
+    {
+        free (sets);
+        free (perm);
+        return -1;
+    }
+
+    // Each working set, a random sample of the objects (the
+    // first ones of a partial shuffle)
+    for (u=0; u<P->numobjects; u++)
+        perm[u] = u;
+
+    for (s=0; s<P->numsets; s++)
+        for (u=0; u<P->setsize; u++)
+        {
+            v = u + next_random() % (P->numobjects-u);
+            tmp = perm[u];
+            perm[u] = perm[v];
+            perm[v] = tmp;
+            sets[s*P->setsize+u] = perm[u];
+        }
+
+    free (perm);
+
+    for (r=0; r<P->numrefs && ok; r++, left--)
+    {
+        // End of the phase: its length is geometric, with the
+        // given mean, and the next set is any other one
+        if (!left)
+        {
+            left = P->phaselen>1 ?
+                   1 + log (1-uniform()) / log (1-1/P->phaselen) : 1;
+
+            if (r && P->numsets>1)
+                set = (set + 1 + next_random() % (P->numsets-1))
+                      % P->numsets;
+        }
+
+        ok = reference (W, P, sets[set*P->setsize +
+                                   alias_draw(&A,next_random())]) == 0;
+    }
+
+    alias_free (&A);
+    free (sets);
+    return ok ? 0 : -1;
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;
+    stracewriter W;
+    int ok;
+
+    if (parse_command(argc,argv,&P)<0)
+        return -1;
+
+    seed_random (P.seed);
+    writelimit = P.writes>=1 ? ~0ULL
+                             : (unsigned long long) (P.writes *
+                                                     18446744073709551616.0);
+
+    if (trace_writer_open(&W,stdout,P.format,
+                          P.numobjects*P.unit)<0)
+    {
+        fprintf (stderr, "ERROR: not enough "
+                         "dynamic memory.\n");
+        return -2;
+    }
+
+    if (P.model==MODEL_IRM)
+        ok = irm (&W, &P) == 0;
+    else if (P.model==MODEL_LRU)
+        ok = lru (&W, &P) == 0;
+    else
+        ok = phases (&W, &P) == 0;
+
+    if (!ok)
+        fprintf (stderr, "ERROR: not enough dynamic memory, "
+                         "wrong distances, or the output "
+                         "failed\n");
+
+    // The trace ends as the sorted ones
+    if (trace_writer_close(&W,1)<0)
+        ok = 0;
+
+    return ok ? 0 : -1;
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    const char * models[] = { "IRM", "LRU", "PHA", NULL };
+    const char * name = argv[0];
+    int ok, opt;
+
+    // Default parameters
+    p->model = MODEL_IRM;
+    p->numobjects = 1000;
+    p->numrefs = 1000000;
+    p->alpha = 1;
+    p->distfile = NULL;
+    p->numsets = 4;
+    p->setsize = 0;            // A tenth of the objects
+    p->phaselen = 100000;
+    p->unit = 1;
+    p->writes = 0.25;
+    p->seed = 0;
+    p->format = TRACE_TEXT;
+
+    // Options, before the positional parameters
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "bzs:a:d:k:m:l:u:w:")) != -1)
+        switch (opt)
+        {
+            case 'b':
+                p->format = TRACE_BINARY;
+                break;
+
+            case 'z':
+                p->format = TRACE_BLOCKS;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr, "\n    ERROR: wrong seed\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'a':
+                if (sscanf(optarg,"%lf",&p->alpha)!=1 ||
+                    p->alpha<0)
+                {
+                    fprintf (stderr, "\n    ERROR: wrong alpha\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'd':
+                p->distfile = optarg;
+                break;
+
+            case 'k':
+                if (sscanf(optarg,"%u",&p->numsets)!=1 ||
+                    p->numsets<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of sets\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'm':
+                if (sscanf(optarg,"%u",&p->setsize)!=1 ||
+                    p->setsize<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong size of the sets\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'l':
+                if (sscanf(optarg,"%lf",&p->phaselen)!=1 ||
+                    p->phaselen<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong length of the "
+                                          "phases\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'u':
+                if (sscanf(optarg,"%u",&p->unit)!=1 || p->unit<1)
+                {
+                    fprintf (stderr, "\n    ERROR: wrong unit\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'w':
+                if (sscanf(optarg,"%lf",&p->writes)!=1 ||
+                    p->writes<0 || p->writes>1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong fraction of "
+                                          "writes\n");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
+
+    if (argc>4)
+        ok = 0;
+
+    if (argc>1)
+    {
+        for (p->model=0; models[p->model]; p->model++)
+            if (!strcmp(argv[1],models[p->model]))
+                break;
+
+        if (!models[p->model])
+        {
+            fprintf (stderr, "\n    ERROR: wrong model\n");
+            ok = 0;
+        }
+    }
+
+    if ((argc>2 && (sscanf(argv[2],"%u",&p->numobjects)!=1 ||
+                    p->numobjects<1)) ||
+        (unsigned long long) p->numobjects*p->unit >
+        TRACE_MAX_POS+1ULL)
+    {
+        fprintf (stderr, "\n    ERROR: wrong number of objects\n");
+        ok = 0;
+    }
+
+    if (argc>3 && sscanf(argv[3],"%llu",&p->numrefs)!=1)
+    {
+        fprintf (stderr, "\n    ERROR: wrong number of "
+                                      "references\n");
+        ok = 0;
+    }
+
+    if (!p->setsize)
+        p->setsize = p->numobjects>=10 ? p->numobjects/10 : 1;
+
+    if (ok && p->setsize>p->numobjects)
+    {
+        fprintf (stderr, "\n    ERROR: sets larger than the "
+                                      "objects\n");
+        ok = 0;
+    }
+
+    if (!ok)
+    {
+        fprintf (stderr,
+             "\n    USAGE:\n\t%s [options] model objects "
+                        "references\n\n"
+             "\tmodel: IRM (Zipf), LRU (stack model) or PHA "
+                      "(phases)\n"
+             "\tobjects: # of objects referenced (1000)\n"
+             "\treferences: # of references (1000000)\n\n"
+             "\t-a alpha: exponent of the Zipf distributions (1, "
+                         "0 = uniform)\n"
+             "\t-d file: LRU distances, from lines \"distance "
+                        "weight\" (0 =\n"
+             "\t         new object); Zipf distances by default\n"
+             "\t-k sets: working sets of PHA (4)\n"
+             "\t-m size: objects in each set (a tenth of them)\n"
+             "\t-l refs: mean length of the phases (100000)\n"
+             "\t-u unit: elements of each object (1)\n"
+             "\t-w frac: fraction of writes (0.25)\n"
+             "\t-s seed: seed of the random numbers (0)\n"
+             "\t-b, -z: binary or compressed trace (text by "
+                       "default)\n\n"
+             "\tExample: %s -z -a 0.8 IRM 100000 100000000 > "
+                        "irm.trace\n\n",
+             name, name);
+
+        return -1;
+    }
+
+    return 0;
+}
@@ -5,17 +5,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <getopt.h>
 
 #include "sort.h"
+#include "workloads.h"
+#include "alias.h"
+#include "trace.h"
 
 // Functions that prepare the data according to
 // different criteria:
 
-typedef void function_prepare_data (thing A[], unsigned size);
+typedef void function_prepare_data (thing A[], unsigned size,
+                                    unsigned seed, unsigned param);
 
 function_prepare_data ascending_order,
                       descending_order,
-                      random_order;
+                      random_order,
+                      nearly_sorted,
+                      few_unique,
+                      sawtooth,
+                      organ_pipe,
+                      zipf_keys,
+                      sorted_runs,
+                      adversary_order;
+
+// The sorting algorithm that adversary_order plays against, and
+// the elements it needs
+
+static function_sort * victim;
+static function_sort_space * victimspace;
+
+// Run a sorting algorithm, with its random numbers (those of the
+// pivots of QRP) drawn from the seed
+
+static unsigned run_sort (function_sort *, void *, unsigned size,
+                          unsigned seed, function_lesser_than *,
+                          function_read *, function_write *);
 
 // Functions that the sorting algorithms should use in order
 // to access the data of the array:
@@ -35,24 +60,72 @@ int lesser_than_back_to_front (void *, thing a, thing b);
 typedef struct
 {
     thing * pdata;            // Array with data to be sorted
-    unsigned nreads;          // Read operations counter
-    unsigned nwrites;         // Write operations counter
-    unsigned ncomparisons;    // Comparisons counter
-    FILE * pf;                // Operations log
+    unsigned long long nreads;        // Read operations counter
+    unsigned long long nwrites;       // Write operations counter
+    unsigned long long ncomparisons;  // Comparisons counter
+    stracewriter * pf;        // Operations log (NULL = off, or
+                              // failed: see W.failed)
 }
 scontrol;
 
+// Workloads other than sorting (see workloads.h), with the
+// default value and the range of their parameter, and the
+// maximum size
+
+typedef struct
+{
+    function_workload * prun;
+    function_workload_size * psize;
+    function_workload_init * pinit;
+    function_workload_check * pcheck;
+    unsigned param, minparam, maxparam;
+    int maxsize;
+}
+sworkload;
+
+// Sorting algorithms, with the elements they need, and the
+// function that sets their parameter, its default value and its
+// range, if they have one
+
+typedef struct
+{
+    function_sort * pfun;
+    const char * name;
+    function_sort_space * pspace;  // NULL = only the array
+    void (* pparam) (unsigned);    // NULL = no parameter
+    unsigned param, minparam, maxparam;
+}
+ssort;
+
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
 
 typedef struct
 {
     function_prepare_data * pprepare;
+    unsigned orderparam;  // Parameter of the initial order
+                          // (0 = default)
     function_sort * psort;
+    function_sort_space * pspace;  // Elements it needs (NULL =
+                                   // only the array)
+    const sworkload * pwork;  // Instead of psort (NULL = sort)
+    int param;         // Parameter of the workload or of the
+                       // sorting algorithm (-1 = default)
     int size;
+    unsigned seed;     // Seed of the random initial orders
+                       // and pivots
+    int format;        // TRACE_TEXT, TRACE_BINARY or TRACE_BLOCKS
+    int count;         // Only count the operations (no trace)
 }
 sparameters;
 
+// Sizes of the array: a trace has room for about 10^9 positions,
+// but the traces of a few thousand elements are long enough
+// already. When only counting, the limit is the memory.
+
+#define MAX_SIZE        10000
+#define MAX_SIZE_COUNT  100000000
+
 // Function that parses the parameters received through the
 // command line:
 
@@ -64,17 +137,34 @@ int main (int argc, char * argv[])
 {
     thing * A;         // Dynamic array with data to sort
     scontrol C;        // Struct controlling access to array
+    stracewriter W;    // Output of the operations log
     sparameters P;     // Parameters
     unsigned totalsz;  // Total # of elements (2*size in MER)
+    thing * order;     // Initial order of a workload
     unsigned u;
+    int ok, sorted;
 
     if (parse_command(argc,argv,&P)<0)
         return -1;
 
-    totalsz = P.psort==merge_sort ? P.size*2 : P.size;
+    if (P.pwork)
+        totalsz = P.pwork->psize (P.size, P.param);
+    else
+        totalsz = P.pspace ? P.pspace (P.size) : P.size;
+
+    // The binary formats keep 30 bits of each position
+    if (!P.count && P.format!=TRACE_TEXT && totalsz-1>TRACE_MAX_POS)
+    {
+        fprintf (stderr, "ERROR: %u elements do not fit in a binary "
+                         "trace (up to %u)\n", totalsz,
+                 TRACE_MAX_POS+1);
+        return -1;
+    }
+
     A = (thing*) malloc (totalsz*sizeof(thing));
+    order = P.pwork ? (thing*) malloc (P.size*sizeof(thing)) : A;
 
-    if (!A)
+    if (!A || !order)
     {
         fprintf (stderr, "ERROR: not enough "
                          "dynamic memory.\n");
@@ -84,31 +174,95 @@ int main (int argc, char * argv[])
     C.pdata = A;
 
     // Generate data in specified initial state
-    P.pprepare (A, P.size);
+    P.pprepare (order, P.size, P.seed, P.orderparam);
+
+    if (P.pwork)
+    {
+        P.pwork->pinit (A, P.size, P.param, order);
+        free (order);
+    }
 
     // Reset counters
     C.nreads = C.nwrites = C.ncomparisons = 0;
-    C.pf = stdout;
+    C.pf = P.count ? NULL : &W;
 
     // Show total size
-    printf (" T%u\n", totalsz);
+    if (C.pf && trace_writer_open(&W,stdout,P.format,totalsz)<0)
+    {
+        fprintf (stderr, "ERROR: not enough "
+                         "dynamic memory.\n");
+        free (A);
+        return -2;
+    }
 
-    // Sort data with specified algorithm
-    P.psort (&C,
-             P.size,
-             lesser_than,
-             read,
-             write);
+    // Sort data with specified algorithm (or run the workload)
+    if (P.pwork)
+        P.pwork->prun (&C,
+                       P.size,
+                       P.param,
+                       lesser_than,
+                       read,
+                       write);
+    else
+        run_sort (P.psort,
+                  &C,
+                  P.size,
+                  P.seed,
+                  lesser_than,
+                  read,
+                  write);
+
+    if (P.count)
+    {
+        // The counters, before checking the order
+        printf ("Reads: %llu\nWrites: %llu\nComparisons: %llu\n",
+                C.nreads, C.nwrites, C.ncomparisons);
+    }
 
     C.pf = NULL;
 
-    for (u=0; u<P.size-1; u++)
-        if (lesser_than(&C,A[u+1],A[u]))
-            break;
+    if (P.pwork)
+        sorted = P.pwork->pcheck (A, P.size, P.param);
+    else
+    {
+        for (u=0; u<P.size-1; u++)
+            if (lesser_than(&C,A[u+1],A[u]))
+                break;
+
+        sorted = u==P.size-1;
+    }
+
+    if (P.count)
+    {
+        printf ("%s\n", sorted ? "Sorted" : "Out of order");
+        ok = sorted;
+    }
+    else if (trace_writer_close(&W,sorted)<0)
+    {
+        // Incomplete, so the trace cache does not keep it
+        fprintf (stderr, "ERROR: the trace could not be written "
+                         "(not enough dynamic memory, or the "
+                         "output failed)\n");
+        ok = 0;
+    }
+    else
+        ok = 1;
 
-    printf (" %s\n", u<P.size-1?"Out of order :-(":"Sorted ;-)");
     free (A);
-    return 0;
+    return ok ? 0 : -1;
+}
+
+static unsigned run_sort (function_sort * psort, void * p,
+                          unsigned size, unsigned seed,
+                          function_lesser_than * plesserthan,
+                          function_read * pread,
+                          function_write * pwrite)
+{
+    if (psort==quick_sort_pa)
+        return quick_sort_pa_seeded (p, size, seed, plesserthan,
+                                     pread, pwrite);
+
+    return psort (p, size, plesserthan, pread, pwrite);
 }
 
 // Functions that the sorting algorithms should use in order
@@ -120,15 +274,8 @@ thing read (void * p, unsigned pos)
 
     pc->nreads ++;
 
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " R%u", pos);
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
+    if (pc->pf && trace_write_op(pc->pf,'R',pos)<0)
+        pc->pf = NULL;
 
     return pc->pdata[pos];
 }
@@ -139,15 +286,8 @@ void write (void * p, unsigned pos, thing value)
 
     pc->nwrites ++;
 
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " W%u", pos);
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
+    if (pc->pf && trace_write_op(pc->pf,'W',pos)<0)
+        pc->pf = NULL;
 
     pc->pdata[pos] = value;
 }
@@ -161,15 +301,8 @@ int lesser_than (void * p, thing a, thing b)
 
     pc->ncomparisons ++;
 
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " C");
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
+    if (pc->pf && trace_write_op(pc->pf,'C',0)<0)
+        pc->pf = NULL;
 
     return a < b;
 }
@@ -180,15 +313,8 @@ int lesser_than_back_to_front (void * p, thing a, thing b)
 
     pc->ncomparisons ++;
 
-    if (pc->pf)
-    {
-        fprintf (pc->pf, " C");
-
-        if (((pc->nreads+
-              pc->nwrites+
-              pc->ncomparisons) & 7) == 0)
-            fputc ('\n', pc->pf);
-    }
+    if (pc->pf && trace_write_op(pc->pf,'C',0)<0)
+        pc->pf = NULL;
 
     return a > b;
 }
@@ -196,7 +322,8 @@ int lesser_than_back_to_front (void * p, thing a, thing b)
 // Functions that prepare the data according to
 // different criteria:
 
-void ascending_order (thing A[], unsigned size)
+void ascending_order (thing A[], unsigned size, unsigned seed,
+                      unsigned param)
 {
     unsigned u;
 
@@ -204,7 +331,8 @@ void ascending_order (thing A[], unsigned size)
         A[u] = u;
 }
 
-void descending_order (thing A[], unsigned size)
+void descending_order (thing A[], unsigned size, unsigned seed,
+                       unsigned param)
 {
     unsigned u;
 
@@ -212,17 +340,33 @@ void descending_order (thing A[], unsigned size)
         A[u] = size-u-1;
 }
 
-void random_order (thing A[], unsigned size)
+// Start the random numbers of an initial order, and draw them
+
+static void start_random (unsigned seed)
 {
-    unsigned u, n;
-    thing tmp;
+    unsigned u;
 
-    srand (0);
+    srand (seed);
 
     for (u=0; u<5; u++)
         rand ();
+}
+
+static unsigned random_below (unsigned n)
+{
+    unsigned r = (unsigned) (rand() / (RAND_MAX+1.0) * n);
+
+    return r<n ? r : n-1;
+}
+
+void random_order (thing A[], unsigned size, unsigned seed,
+                   unsigned param)
+{
+    unsigned u, n;
+    thing tmp;
 
-    ascending_order (A, size);
+    start_random (seed);
+    ascending_order (A, size, seed, param);
 
     for (u=0; u<size-1; u++)
     {
@@ -240,6 +384,225 @@ void random_order (thing A[], unsigned size)
     }
 }
 
+// Ascending order, with 'param' swaps of two elements at
+// random (size/100 by default)
+
+void nearly_sorted (thing A[], unsigned size, unsigned seed,
+                    unsigned param)
+{
+    unsigned u, i, j;
+    thing tmp;
+
+    start_random (seed);
+    ascending_order (A, size, seed, param);
+
+    for (u=0; u<(param ? param : size/100+1); u++)
+    {
+        i = random_below (size);
+        j = random_below (size);
+        tmp = A[i];
+        A[i] = A[j];
+        A[j] = tmp;
+    }
+}
+
+// Only 'param' different keys (8 by default), at random
+
+void few_unique (thing A[], unsigned size, unsigned seed,
+                 unsigned param)
+{
+    unsigned u;
+
+    start_random (seed);
+
+    for (u=0; u<size; u++)
+        A[u] = random_below (param ? param : 8);
+}
+
+// 'param' ascending ramps (4 by default)
+
+void sawtooth (thing A[], unsigned size, unsigned seed,
+               unsigned param)
+{
+    unsigned u, teeth = param ? param : 4;
+    unsigned period = (size+teeth-1) / teeth;
+
+    for (u=0; u<size; u++)
+        A[u] = u % period;
+}
+
+// Ascending up to the middle, then descending: 0 1 2 2 1 0
+
+void organ_pipe (thing A[], unsigned size, unsigned seed,
+                 unsigned param)
+{
+    unsigned u;
+
+    for (u=0; u<size; u++)
+        A[u] = u<size/2 ? u : size-1-u;
+}
+
+// Keys with duplicates, at random: key k, from 'param' keys (size
+// by default), is drawn with a probability proportional to
+// 1/(k+1) (Zipf)
+
+void zipf_keys (thing A[], unsigned size, unsigned seed,
+                unsigned param)
+{
+    unsigned u, numkeys = param ? param : size;
+    unsigned long long r;
+    double * weights;
+    salias Z;
+
+    start_random (seed);
+
+    weights = (double*) malloc (numkeys*sizeof(double));
+
+    if (weights)
+        zipf_weights (weights, numkeys, 1);
+
+    if (!weights || alias_init(&Z,weights,numkeys)<0)
+    {
+        // Without memory, the first key at least is the most
+        // frequent
+        free (weights);
+        few_unique (A, size, seed, 2);
+        return;
+    }
+
+    free (weights);
+
+    for (u=0; u<size; u++)
+    {
+        // 64 bits from rand (31 each)
+        r = (unsigned long long) rand() << 62 ^
+            (unsigned long long) rand() << 31 ^ rand();
+        A[u] = alias_draw (&Z, r);
+    }
+
+    alias_free (&Z);
+}
+
+// Blocks of 'param' elements in ascending order (32 by
+// default): a random permutation with each block sorted
+
+static int compare_things (const void * a, const void * b)
+{
+    thing x = *(const thing*) a, y = *(const thing*) b;
+
+    return x<y ? -1 : x>y;
+}
+
+void sorted_runs (thing A[], unsigned size, unsigned seed,
+                  unsigned param)
+{
+    unsigned u, run = param ? param : 32;
+
+    random_order (A, size, seed, param);
+
+    for (u=0; u<size; u+=run)
+        qsort (A+u, u+run<size ? run : size-u, sizeof(thing),
+               compare_things);
+}
+
+// Adversary (McIlroy, "A killer adversary for quicksort"): the
+// victim sorts items whose values are only decided when they
+// are compared. At first, all of them are "gas", greater than
+// any value given. When two gas items are compared, one of
+// them is frozen with the lowest value not given yet: the one
+// that was compared with a solid one last time, which is most
+// likely the pivot of a quicksort; so pivots turn out to be the
+// smallest elements. The values are consistent with all the
+// answers, so sorting them again goes the same way. It works
+// against any algorithm, including quick_sort_pa, which draws
+// the same pivots in every sort with the same seed.
+
+typedef struct
+{
+    thing * pdata;        // Array with the items (their number)
+    unsigned * value;     // Value of each item (gas = size)
+    unsigned numsolid;    // Values given so far
+    unsigned gas;
+    unsigned candidate;   // Gas item compared last time
+}
+sadversary;
+
+static thing adversary_read (void * p, unsigned pos)
+{
+    return ((sadversary*) p)->pdata[pos];
+}
+
+static void adversary_write (void * p, unsigned pos, thing value)
+{
+    ((sadversary*) p)->pdata[pos] = value;
+}
+
+static int adversary_lesser_than (void * p, thing a, thing b)
+{
+    sadversary * pv = (sadversary*) p;
+    unsigned x = a, y = b;
+
+    if (pv->value[x]==pv->gas && pv->value[y]==pv->gas)
+    {
+        if (x==pv->candidate)
+            pv->value[x] = pv->numsolid++;
+        else
+            pv->value[y] = pv->numsolid++;
+    }
+
+    if (pv->value[x]==pv->gas)
+        pv->candidate = x;
+    else if (pv->value[y]==pv->gas)
+        pv->candidate = y;
+
+    return pv->value[x] < pv->value[y];
+}
+
+void adversary_order (thing A[], unsigned size, unsigned seed,
+                      unsigned param)
+{
+    sadversary V;
+    unsigned u;
+
+    // Room for the victim (and its temporary space)
+    V.pdata = (thing*) malloc ((victimspace ? victimspace (size)
+                                            : size) * sizeof(thing));
+    V.value = (unsigned*) malloc (size*sizeof(unsigned));
+
+    if (!V.pdata || !V.value)
+    {
+        free (V.pdata);
+        free (V.value);
+        random_order (A, size, seed, param);
+        return;
+    }
+
+    V.numsolid = 0;
+    V.gas = size;
+    V.candidate = 0;
+
+    for (u=0; u<size; u++)
+    {
+        V.pdata[u] = u;
+        V.value[u] = V.gas;
+    }
+
+    run_sort (victim, &V, size, seed, adversary_lesser_than,
+              adversary_read, adversary_write);
+
+    // The items never compared with other gas ones go last
+    for (u=0; u<size; u++)
+    {
+        if (V.value[u]==V.gas)
+            V.value[u] = V.numsolid++;
+
+        A[u] = V.value[u];
+    }
+
+    free (V.pdata);
+    free (V.value);
+}
+
 // Function that parses the parameters received through the
 // command line:
 
@@ -247,36 +610,141 @@ int parse_command (int argc, char * argv[],
                    sparameters * pPar)
 {
     unsigned u;
+    int opt, max;
+    const ssort * psorter = NULL;
 
+    // The workloads need a permutation of 0..size-1
     struct
     {
         function_prepare_data * pfun;
         const char * name;
+        int permutation;
     }
-    G[] = { { ascending_order, "ASC" },
-            { descending_order, "DES" },
-            { random_order, "RAN" },
+    G[] = { { ascending_order, "ASC", 1 },
+            { descending_order, "DES", 1 },
+            { random_order, "RAN", 1 },
+            { nearly_sorted, "NEA", 1 },
+            { few_unique, "FEW", 0 },
+            { sawtooth, "SAW", 0 },
+            { organ_pipe, "ORG", 0 },
+            { zipf_keys, "ZIP", 0 },
+            { sorted_runs, "RUN", 1 },
+            { adversary_order, "ADV", 0 },
             { NULL, NULL } };
 
-    struct
-    {
-        function_sort * pfun;
-        const char * name;
-    }
-    S[] = { { bubble_sort, "BUB" },
+    // The blocked heap and the bitonic sort have a parameter,
+    // the size of the blocks, and the radix sorts the width of
+    // the digits
+    static const ssort S[] =
+          { { bubble_sort, "BUB" },
             { insertion_sort, "INS" },
             { selection_sort, "SEL" },
             { heap_sort, "HEA" },
             { comb_sort, "COM" },
-            { merge_sort, "MER" },
+            { merge_sort, "MER", merge_sort_space },
             { quick_sort, "QUI" },
             { quick_sort_pa, "QRP" },
-            { NULL, NULL } }	;
+            { heap_sort_4, "HE4" },
+            { heap_sort_8, "HE8" },
+            { heap_sort_blocked, "HEB", heap_sort_blocked_space,
+              heap_sort_block, HEAP_BLOCK, 4, HEAP_MAX_BLOCK },
+            { natural_merge_sort, "NAT", merge_sort_space },
+            { tim_sort, "TIM", tim_sort_space },
+            { bitonic_sort, "BIT", merge_sort_space,
+              bitonic_sort_block, BITONIC_BLOCK, BITONIC_MIN_BLOCK,
+              BITONIC_MAX_BLOCK },
+            { lsd_radix_sort, "LSD", lsd_radix_sort_space,
+              radix_sort_digit, RADIX_BITS, 1, RADIX_MAX_BITS },
+            { msd_radix_sort, "MSD", msd_radix_sort_space,
+              radix_sort_digit, RADIX_BITS, 1, RADIX_MAX_BITS },
+            { counting_sort, "CNT", counting_sort_space },
+            { NULL, NULL } };
+
+    // Matrix multiply (naive and blocked), hash join, B+-tree
+    // lookups and breadth-first search
+    static struct
+    {
+        sworkload work;
+        const char * name;
+    }
+    W[] = { { { matmul_naive, matmul_size, matmul_init,
+                matmul_naive_check, 0, 0, 1, 1000 }, "MMN" },
+            { { matmul_blocked, matmul_size, matmul_init,
+                matmul_blocked_check, 16, 1, 1000, 1000 }, "MMB" },
+            { { hash_join, hash_join_size, hash_join_init,
+                hash_join_check, 50, 1, 90, 10000000 }, "HJN" },
+            { { btree_lookup, btree_size, btree_init,
+                btree_check, 16, 2, 1024, 10000000 }, "BTR" },
+            { { bfs, bfs_size, bfs_init,
+                bfs_check, 8, 2, 64, 10000000 }, "BFS" },
+            { { NULL }, NULL } };
 
     // Default parameters:
     pPar->pprepare = random_order;
+    pPar->orderparam = 0;
     pPar->psort = merge_sort;
+    pPar->pspace = merge_sort_space;
+    pPar->pwork = NULL;
+    pPar->param = -1;
     pPar->size = 4;
+    pPar->seed = 0;
+    pPar->format = TRACE_TEXT;
+    pPar->count = 0;
+
+    // Options, before the positional parameters
+
+    while ((opt = getopt(argc, argv, "bzcs:p:i:")) != -1)
+        switch (opt)
+        {
+            case 'b':
+                pPar->format = TRACE_BINARY;
+                break;
+
+            case 'z':
+                pPar->format = TRACE_BLOCKS;
+                break;
+
+            case 'c':
+                pPar->count = 1;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&pPar->seed)!=1)
+                {
+                    fprintf (stderr, "ERROR: Wrong seed \"%s\"\n",
+                                     optarg);
+                    return -1;
+                }
+                break;
+
+            case 'i':
+                if (sscanf(optarg,"%u",&pPar->orderparam)!=1 ||
+                    pPar->orderparam<1)
+                {
+                    fprintf (stderr, "ERROR: Wrong parameter of the "
+                                     "initial order \"%s\"\n",
+                                     optarg);
+                    return -1;
+                }
+                break;
+
+            case 'p':
+                if (sscanf(optarg,"%d",&pPar->param)!=1 ||
+                    pPar->param<0)
+                {
+                    fprintf (stderr, "ERROR: Wrong parameter "
+                                     "\"%s\"\n", optarg);
+                    return -1;
+                }
+                break;
+
+            default:
+                return -1;
+        }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
 
     if (argc>1)
     {
@@ -285,12 +753,25 @@ int parse_command (int argc, char * argv[],
                 break;
 
         if (S[u].pfun)
+        {
+            psorter = &S[u];
             pPar->psort = S[u].pfun;
+            pPar->pspace = S[u].pspace;
+        }
         else
         {
-            fprintf (stderr, "ERROR: Unknown sorting "
-                             "algorithm \"%s\"\n", argv[1]);
-            return -1;
+            for (u=0; W[u].name; u++)
+                if (!strcmp(argv[1],W[u].name))
+                    break;
+
+            if (W[u].name)
+                pPar->pwork = &W[u].work;
+            else
+            {
+                fprintf (stderr, "ERROR: Unknown sorting "
+                                 "algorithm \"%s\"\n", argv[1]);
+                return -1;
+            }
         }
     }
 
@@ -300,8 +781,30 @@ int parse_command (int argc, char * argv[],
             if (!strcmp(argv[2],G[u].name))
                 break;
 
-        if (G[u].pfun)
+        if (G[u].pfun==adversary_order &&
+            (pPar->psort==lsd_radix_sort ||
+             pPar->psort==msd_radix_sort ||
+             pPar->psort==counting_sort ||
+             pPar->psort==bitonic_sort))
+        {
+            fprintf (stderr, "ERROR: The adversary only plays "
+                             "against comparisons\n");
+            return -1;
+        }
+        else if (G[u].pfun && (G[u].permutation || !pPar->pwork))
             pPar->pprepare = G[u].pfun;
+        else if (G[u].pfun==adversary_order)
+        {
+            fprintf (stderr, "ERROR: The adversary only plays "
+                             "against the sorting algorithms\n");
+            return -1;
+        }
+        else if (G[u].pfun)
+        {
+            fprintf (stderr, "ERROR: The workloads need an initial "
+                             "state without repeated keys\n");
+            return -1;
+        }
         else
         {
             fprintf (stderr, "ERROR: Unknown initial "
@@ -310,19 +813,76 @@ int parse_command (int argc, char * argv[],
         }
     }
 
+    if (pPar->pwork)
+        max = pPar->pwork->maxsize;
+    else
+        max = pPar->count ? MAX_SIZE_COUNT : MAX_SIZE;
+
     if (argc>3)
     {
         u = sscanf (argv[3], "%d", &pPar->size);
 
-        if (u!=1 || pPar->size<2 || pPar->size>10000)
+        if (u!=1 || pPar->size<2 || pPar->size>max)
         {
             fprintf (stderr, "ERROR: Wrong size (must be "
                              "a number ranging from 2 "
-                             "to 10000\n");
+                             "to %d)\n", max);
             return -1;
         }
     }
 
+    // The counting sort has a bucket for each key below the
+    // size, and only FEW and ZIP can give larger keys
+    if (pPar->psort==counting_sort &&
+        ((pPar->pprepare==few_unique &&
+          (pPar->orderparam ? pPar->orderparam : 8) >
+          (unsigned) pPar->size) ||
+         (pPar->pprepare==zipf_keys &&
+          pPar->orderparam > (unsigned) pPar->size)))
+    {
+        fprintf (stderr, "ERROR: The counting sort needs no more "
+                         "keys than elements (-i)\n");
+        return -1;
+    }
+
+    // Only the workloads and some sorting algorithms have a
+    // parameter
+    if (psorter && psorter->pparam && pPar->param<0)
+        pPar->param = psorter->param;
+    else if (psorter && psorter->pparam &&
+             (pPar->param<psorter->minparam ||
+              pPar->param>psorter->maxparam))
+    {
+        fprintf (stderr, "ERROR: Wrong parameter (must be "
+                         "a number ranging from %u to %u)\n",
+                 psorter->minparam, psorter->maxparam);
+        return -1;
+    }
+    else if (pPar->pwork && pPar->param<0)
+        pPar->param = pPar->pwork->param;
+    else if (pPar->pwork && (pPar->param<pPar->pwork->minparam ||
+                             pPar->param>pPar->pwork->maxparam))
+    {
+        fprintf (stderr, "ERROR: Wrong parameter (must be "
+                         "a number ranging from %u to %u)\n",
+                 pPar->pwork->minparam, pPar->pwork->maxparam);
+        return -1;
+    }
+    else if (!pPar->pwork && pPar->param>=0 &&
+             !(psorter && psorter->pparam))
+    {
+        fprintf (stderr, "ERROR: This algorithm has no "
+                         "parameter\n");
+        return -1;
+    }
+
+    // Before the sizes are computed
+    if (psorter && psorter->pparam)
+        psorter->pparam (pPar->param);
+
+    victim = pPar->psort;      // For the ADV initial state
+    victimspace = pPar->pspace;
+
     return 0;
 }
 
@@ -0,0 +1,404 @@
+/*
+    monte_carlo.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <math.h>
+
+// One run of the simulator, with its seeds
+
+typedef struct
+{
+    unsigned policyseed;   // -r: seed of the random replacement
+    unsigned traceseed;    // -s: seed of the order and pivots
+    double counters[2];    // Page faults and write-backs
+    int ok;                // 0 if an error occurred
+}
+srun;
+
+// The runs, shared by the threads, which take the next one to
+// do until there are none left
+
+typedef struct
+{
+    srun * runs;
+    int numruns;
+    int next;              // Next run to do
+    const char * simulator;
+    const char * command;  // Parameters of the simulator
+    pthread_mutex_t lock;
+}
+spool;
+
+// Structure holding data of the parameters passed through
+// the command line
+
+typedef struct
+{
+    int numruns;
+    int numthreads;
+    unsigned seed;         // Seed of the first run
+    int vary;              // 1 = vary the seed of the trace too
+    const char * simulator;
+    const char * csvfile;
+    char command[FILENAME_MAX];
+}
+sparameters;
+
+int parse_command (int argc, char * argv[], sparameters * p);
+
+int simulate (const char * simulator, const char * command,
+              srun * run);
+
+void * run_worker (void * p);
+
+// Two-sided 95% quantiles of Student's t, for 1..30 degrees of
+// freedom
+
+static const double student95[30] =
+{
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+    2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+    2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+    2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double student (int df)
+{
+    // Beyond the table, the first term of its expansion
+    return df<=30 ? student95[df-1] : 1.96 + 2.37/df;
+}
+
+// Mean, standard deviation (of the sample) and 95% confidence
+// interval of the mean of a counter, in the runs that went right
+
+static void summary (const char * name, const srun * runs,
+                     int numruns, int counter)
+{
+    double x, sum = 0, sum2 = 0, mean, stddev = 0, half = 0;
+    int r, n = 0;
+
+    for (r=0; r<numruns; r++)
+        if (runs[r].ok)
+        {
+            x = runs[r].counters[counter];
+            sum += x;
+            n ++;
+        }
+
+    mean = n ? sum/n : 0;
+
+    for (r=0; r<numruns; r++)
+        if (runs[r].ok)
+        {
+            x = runs[r].counters[counter];
+            sum2 += (x-mean) * (x-mean);
+        }
+
+    if (n>1)
+    {
+        stddev = sqrt (sum2/(n-1));
+        half = student (n-1) * stddev / sqrt (n);
+    }
+
+    printf ("%-14s %12.2f %12.2f %12.2f %12.2f %9.2f%%\n", name,
+            mean, stddev, mean-half, mean+half,
+            mean ? 100*half/mean : 0);
+}
+
+int main (int argc, char * argv[])
+{
+    sparameters P;     // Parameters
+    spool Q;           // Runs to do
+    pthread_t * threads;
+    FILE * csv;
+    int r, t, n, ok;
+
+    if (parse_command(argc,argv,&P)<0)
+        return -1;
+
+    Q.numruns = P.numruns;
+    Q.runs = (srun*) calloc (Q.numruns, sizeof(srun));
+    Q.simulator = P.simulator;
+    Q.command = P.command;
+    pthread_mutex_init (&Q.lock, NULL);
+
+    if (P.numthreads > Q.numruns)
+        P.numthreads = Q.numruns;
+
+    threads = (pthread_t*) malloc (P.numthreads*sizeof(pthread_t));
+
+    if (!Q.runs || !threads)
+    {
+        fprintf (stderr, "ERROR: not enough dynamic memory\n");
+        return -1;
+    }
+
+    for (r=0; r<Q.numruns; r++)
+    {
+        Q.runs[r].policyseed = P.seed + r;
+        Q.runs[r].traceseed = P.vary ? P.seed + r : 0;
+    }
+
+    printf ("# Simulator:  %s %s\n", P.simulator, P.command);
+    printf ("# Runs:  %d, seeds %u..%u of the policy%s\n",
+            Q.numruns, P.seed, P.seed+Q.numruns-1,
+            P.vary ? " and the trace" : "");
+
+    // If all the runs share the trace, the first one alone, so
+    // that the others find it in the cache instead of all of
+    // them generating it at the same time
+
+    Q.next = P.vary ? 0 : 1;
+
+    if (!P.vary)
+        Q.runs[0].ok = simulate (Q.simulator, Q.command, &Q.runs[0]);
+
+    for (n=0; n<P.numthreads; n++)
+        if (pthread_create(&threads[n],NULL,run_worker,&Q))
+            break;
+
+    if (!n)
+    {
+        perror ("ERROR creating the threads");
+        return -1;
+    }
+
+    for (t=0; t<n; t++)
+        pthread_join (threads[t], NULL);
+
+    for (ok=1, n=0, r=0; r<Q.numruns; r++)
+        if (Q.runs[r].ok)
+            n ++;
+        else
+            ok = 0;
+
+    printf ("\n%d runs\n\n", n);
+    printf ("%-14s %12s %12s %12s %12s %10s\n", "", "Mean",
+            "Std. dev.", "95% CI from", "to", "+/-");
+
+    summary ("Page faults", Q.runs, Q.numruns, 0);
+    summary ("Write-backs", Q.runs, Q.numruns, 1);
+
+    if (P.csvfile)
+    {
+        csv = fopen (P.csvfile, "w");
+
+        if (!csv)
+        {
+            perror (P.csvfile);
+            ok = 0;
+        }
+        else
+        {
+            fprintf (csv, "policyseed,traceseed,faults,writebacks\n");
+
+            for (r=0; r<Q.numruns; r++)
+                if (Q.runs[r].ok)
+                    fprintf (csv, "%u,%u,%.0f,%.0f\n",
+                             Q.runs[r].policyseed,
+                             Q.runs[r].traceseed,
+                             Q.runs[r].counters[0],
+                             Q.runs[r].counters[1]);
+
+            if (fclose(csv))
+                ok = 0;
+        }
+    }
+
+    pthread_mutex_destroy (&Q.lock);
+    free (Q.runs);
+    free (threads);
+
+    return ok ? 0 : -1;
+}
+
+// Run the simulator with the seeds of the run, and take the
+// counters from its general report
+
+int simulate (const char * simulator, const char * command,
+              srun * run)
+{
+    char line[2*FILENAME_MAX];
+    FILE * pipe;
+    int found = 0;
+
+    snprintf (line, sizeof(line), "%s -r %u -s %u %s", simulator,
+              run->policyseed, run->traceseed, command);
+
+    pipe = popen (line, "r");
+
+    if (!pipe)
+        return 0;
+
+    while (fgets(line,sizeof(line),pipe))
+    {
+        if (sscanf(line,"Page faults: %lf",&run->counters[0])==1)
+            found |= 1;
+        else if (sscanf(line,"Page dumps to disc: %lf",
+                        &run->counters[1])==1)
+            found |= 2;
+    }
+
+    return pclose (pipe)==0 && found==3;
+}
+
+void * run_worker (void * p)
+{
+    spool * Q = (spool*) p;
+    srun * run;
+
+    for (;;)
+    {
+        pthread_mutex_lock (&Q->lock);
+        run = Q->next < Q->numruns ? &Q->runs[Q->next++] : NULL;
+        pthread_mutex_unlock (&Q->lock);
+
+        if (!run)
+            return NULL;
+
+        run->ok = simulate (Q->simulator, Q->command, run);
+
+        if (!run->ok)
+        {
+            pthread_mutex_lock (&Q->lock);
+            fprintf (stderr, "ERROR in the run with seeds %u %u\n",
+                     run->policyseed, run->traceseed);
+            pthread_mutex_unlock (&Q->lock);
+        }
+    }
+}
+
+// Function that parses the parameters received through the
+// command line:
+
+int parse_command (int argc, char * argv[], sparameters * p)
+{
+    int ok, opt, n, len;
+    const char * name = argv[0];
+
+    // Default parameters
+    p->numruns = 30;
+    p->numthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    p->seed = 1;
+    p->vary = 0;
+    p->simulator = "./sim_pag_random";
+    p->csvfile = NULL;
+
+    if (p->numthreads<1)
+        p->numthreads = 1;
+
+    // Options, before the parameters of the simulator
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "R:j:s:x:o:t")) != -1)
+        switch (opt)
+        {
+            case 'R':
+                if (sscanf(optarg,"%d",&p->numruns)!=1 ||
+                    p->numruns<2)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of runs\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'j':
+                if (sscanf(optarg,"%d",&p->numthreads)!=1 ||
+                    p->numthreads<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of "
+                                          "threads\n");
+                    ok = 0;
+                }
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed\n");
+                    ok = 0;
+                }
+                break;
+
+            case 'x':
+                p->simulator = optarg;
+                break;
+
+            case 'o':
+                p->csvfile = optarg;
+                break;
+
+            case 't':
+                p->vary = 1;
+                break;
+
+            default:
+                ok = 0;
+        }
+
+    // The rest go to the simulator as they are (they are
+    // checked by it)
+
+    p->command[0] = '\0';
+
+    for (len=0, n=optind; n<argc && ok; n++)
+    {
+        if (strchr(argv[n],'\'') ||
+            len+strlen(argv[n])+4 > sizeof(p->command))
+        {
+            fprintf (stderr,
+                     "\n    ERROR: wrong parameters\n");
+            ok = 0;
+        }
+        else
+            len += sprintf (p->command+len, "%s'%s'",
+                            len ? " " : "", argv[n]);
+    }
+
+    if (ok && optind==argc)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: missing parameters of the "
+                              "simulator\n");
+        ok = 0;
+    }
+
+    if (!ok)
+    {
+        fprintf (stderr,
+             "\n    Use: %s [options] pagesize numframes alg "
+                          "initord numelem\n\n"
+             "\tRun a simulator several times, each with another\n"
+             "\tseed of the random replacement (-r), and show the\n"
+             "\tmean, the standard deviation and the 95%%\n"
+             "\tconfidence interval of the page faults and the\n"
+             "\twrite-backs. The parameters are those of the\n"
+             "\tsimulator, after -- if they have options (as in\n"
+             "\t-- -f trace pagesize numframes).\n\n"
+             "\t-R runs: number of runs (30)\n"
+             "\t-s seed: seed of the first run (1); the next ones\n"
+             "\t         follow it\n"
+             "\t-t: vary the seed of the trace too (random order\n"
+             "\t    and pivots), not only that of the policy\n"
+             "\t-x simulator: program to run (./sim_pag_random)\n"
+             "\t-j threads: runs at a time (one per CPU)\n"
+             "\t-o file: write the counters of each run to a CSV\n"
+             "\t         file\n\n"
+             "\tExample: %s -R 100 16 32 QRP RAN 1000\n\n",
+             name, name);
+
+        return -1;
+    }
+
+    return 0;
+}
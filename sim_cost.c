@@ -0,0 +1,208 @@
+/*
+    sim_cost.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_cost.h"
+
+// Default latencies, in ns, and queue depths of the devices
+
+static const struct
+{
+    const char * name;
+    double latread, latwrite;
+    int depth;
+}
+devices[] = { { NULL,  100000.0,  100000.0,  0 },  // No device
+              { "ssd",  80000.0,  200000.0, 32 },
+              { "hdd", 8000000.0, 8000000.0, 1 },
+              { NULL, 0, 0, 0 } };
+
+int cost_init (scost * C, const char * device,
+               double latmem, double lattlb,
+               double latread, double latwrite)
+{
+    int d, n, depth;
+    char name[8];
+
+    memset (C, 0, sizeof(*C));
+
+    d = 0;
+    depth = -1;
+
+    if (device)
+    {
+        n = sscanf (device, "%7[a-z]:%d", name, &depth);
+
+        for (d=1; devices[d].name; d++)
+            if (n>=1 && !strcmp(name,devices[d].name))
+                break;
+
+        if (!devices[d].name || (n==2 && depth<1))
+            return -1;
+
+        C->device = devices[d].name;
+    }
+
+    C->latmem = latmem>=0 ? latmem : 100.0;
+    C->lattlb = lattlb>=0 ? lattlb : 30.0;
+    C->latread = latread>=0 ? latread : devices[d].latread;
+    C->latwrite = latwrite>=0 ? latwrite : devices[d].latwrite;
+    C->depth = depth>0 ? depth : devices[d].depth;
+
+    if (C->depth)
+    {
+        C->busyuntil = (double*) calloc (C->depth, sizeof(double));
+        C->writing = (char*) calloc (C->depth, sizeof(char));
+
+        if (!C->busyuntil || !C->writing)
+        {
+            cost_free (C);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void cost_free (scost * C)
+{
+    free (C->busyuntil);
+    free (C->writing);
+    C->busyuntil = NULL;
+    C->writing = NULL;
+}
+
+// Submit a request (a write-back or not) to the device at the
+// current time. It's taken by the slot that gets free first.
+// Returns the time when it starts being served; *pend gets when
+// it's done.
+
+static double submit (scost * C, double service, int writeback,
+                      double * pend)
+{
+    int s, first;
+    double start;
+
+    for (s=first=0; s<C->depth; s++)
+        if (C->busyuntil[s] < C->busyuntil[first])
+            first = s;
+
+    start = C->busyuntil[first] > C->now ?
+            C->busyuntil[first] : C->now;
+
+    *pend = C->busyuntil[first] = start + service;
+    C->writing[first] = writeback;
+
+    return start;
+}
+
+void cost_reference (scost * C, unsigned tlbmisses,
+                     unsigned pagereads, unsigned writebacks)
+{
+    double start, end, frameready;
+
+    C->numrefs ++;
+    C->numtlbmisses += tlbmisses;
+    C->numreads += pagereads;
+    C->numwrites += writebacks;
+
+    // Translation
+
+    C->now += tlbmisses * C->lattlb;
+    C->timetlb += tlbmisses * C->lattlb;
+
+    // Page fault: write the victim back, then read the page
+
+    for (frameready=C->now; writebacks; writebacks--)
+        if (!C->depth)
+        {
+            C->now += C->latwrite;
+            C->timewrite += C->latwrite;
+        }
+        else
+        {
+            // Asynchronous: only wait for a free slot, but the
+            // frame is not free until it's written
+            start = submit (C, C->latwrite, 1, &end);
+            C->timewrite += start - C->now;
+            C->now = start;
+
+            if (end > frameready)
+                frameready = end;
+        }
+
+    for (; pagereads; pagereads--)
+        if (!C->depth)
+        {
+            C->now += C->latread;
+            C->timeread += C->latread;
+        }
+        else
+        {
+            // Not before the victim has left the frame
+            if (frameready > C->now)
+            {
+                C->timewrite += frameready - C->now;
+                C->now = frameready;
+            }
+
+            start = submit (C, C->latread, 0, &end);
+            C->timereadqueue += start - C->now;
+            C->timeread += end - C->now;
+            C->now = end;
+        }
+
+    // And finally, the access itself
+
+    C->now += C->latmem;
+    C->timemem += C->latmem;
+}
+
+// Function that shows the results
+
+static void print_time (const char * what, double t, double total)
+{
+    printf ("  %-26s %14.3f ms %6.2f %%\n",
+            what, t/1e6, total>0 ? 100*t/total : 0.0);
+}
+
+void print_cost_report (scost * C)
+{
+    int s, pending;
+
+    if (C->device)
+        printf ("Device:                    %s, queue depth %d\n",
+                C->device, C->depth);
+    else
+        printf ("Device:                    none (synchronous I/O)\n");
+
+    printf ("Latencies (ns):            memory %.0f, TLB miss %.0f,\n"
+            "                           page read %.0f, "
+                                       "write-back %.0f\n\n",
+            C->latmem, C->lattlb, C->latread, C->latwrite);
+
+    printf ("Estimated execution time:  %14.3f ms\n", C->now/1e6);
+    printf ("Effective access time:     %14.3f ns\n",
+            C->numrefs ? C->now/C->numrefs : 0.0);
+
+    printf ("\nTime breakdown:\n");
+    print_time ("Memory accesses:", C->timemem, C->now);
+    print_time ("TLB misses:", C->timetlb, C->now);
+    print_time ("Page reads:", C->timeread, C->now);
+    print_time ("  (queued behind I/O):", C->timereadqueue, C->now);
+    print_time ("Write-backs:", C->timewrite, C->now);
+
+    if (C->depth)
+    {
+        for (s=pending=0; s<C->depth; s++)
+            if (C->writing[s] && C->busyuntil[s] > C->now)
+                pending ++;
+
+        printf ("\nWrite-backs still pending at the end: %d\n",
+                pending);
+    }
+}
@@ -0,0 +1,71 @@
+/*
+    sim_cost.h
+*/
+
+#ifndef _SIM_COST_H_
+#define _SIM_COST_H_
+
+// Cost model: every event of the simulation (memory access,
+// TLB miss, page read and write-back) takes a configurable
+// time, in nanoseconds. The page reads and write-backs can go
+// through a simulated storage device with a queue of a given
+// depth: the device serves up to 'depth' requests at a time,
+// write-backs are asynchronous (the process only waits if the
+// queue is full) and page reads block the process until they
+// are served, queueing behind any pending write-backs. The page
+// read of a fault also waits until the write-back of its victim
+// has finished, as the page goes to the same frame. Without a
+// device (depth 0) all the I/O is synchronous.
+
+typedef struct
+{
+    // Latencies, in ns
+    double latmem;          // Memory access (hit)
+    double lattlb;          // Extra time of a TLB miss
+    double latread;         // Reading a page from disc
+    double latwrite;        // Writing a page back to disc
+
+    // Storage device
+    const char * device;    // Name of the device, if any
+    int depth;              // Queue depth (0 = synchronous)
+    double * busyuntil;     // Time when each slot gets free
+    char * writing;         // 1 = the slot holds a write-back
+
+    // Simulated time and its breakdown, in ns
+    double now;             // Current time
+    double timemem;         // Spent accessing memory
+    double timetlb;         // Spent walking the page table
+    double timeread;        // Waiting for page reads
+    double timereadqueue;   //  ... queued behind other I/O
+    double timewrite;       // Waiting for write-backs (a free
+                            // slot, or the frame of the fault)
+
+    // Counters
+    unsigned numrefs;
+    unsigned numtlbmisses;
+    unsigned numreads;
+    unsigned numwrites;
+}
+scost;
+
+// Set the latencies and the device. 'device' may be "ssd" or
+// "hdd", optionally followed by ":depth", or NULL for no
+// device (synchronous I/O). A latency <0 keeps the default of
+// the device. Returns 0 if OK, -1 if the device is wrong or
+// there is not enough memory
+
+int cost_init (scost * C, const char * device,
+               double latmem, double lattlb,
+               double latread, double latwrite);
+void cost_free (scost * C);
+
+// Account for one memory reference and the events it caused
+
+void cost_reference (scost * C, unsigned tlbmisses,
+                     unsigned pagereads, unsigned writebacks);
+
+// Function that shows the results
+
+void print_cost_report (scost * C);
+
+#endif // _SIM_COST_H_
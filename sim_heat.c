@@ -0,0 +1,262 @@
+/*
+    sim_heat.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sim_heat.h"
+
+#define HEAT_TOP  10    // Ranges in the report
+
+int heat_init (sheat * M, ssystem * S, const char * path,
+               int numbins, unsigned rowrefs)
+{
+    size_t len = strlen (path);
+    int f;
+
+    memset (M, 0, sizeof(*M));
+
+    M->numpags = S->numpags;
+    M->numframes = S->numframes;
+    M->path = path;
+    M->pgm = len>=4 && !strcmp(path+len-4,".pgm");
+
+    // No more ranges than pages
+    M->binpages = (S->numpags+numbins-1) / numbins;
+    M->numbins = (S->numpags+M->binpages-1) / M->binpages;
+    M->rowrefs = rowrefs;
+
+    M->refs = (unsigned*) calloc (M->numpags, sizeof(unsigned));
+    M->faults = (unsigned*) calloc (M->numpags, sizeof(unsigned));
+    M->writebacks = (unsigned*) calloc (M->numpags,
+                                        sizeof(unsigned));
+    M->framepage = (int*) malloc (M->numframes*sizeof(int));
+
+    // The first row of the image
+    M->maxrows = 64;
+    M->rows = (unsigned*) calloc (M->maxrows*M->numbins,
+                                  sizeof(unsigned));
+
+    if (!M->refs || !M->faults || !M->writebacks ||
+        !M->framepage || !M->rows)
+    {
+        heat_free (M);
+        return -1;
+    }
+
+    for (f=0; f<M->numframes; f++)
+        M->framepage[f] = -1;
+
+    return 0;
+}
+
+void heat_free (sheat * M)
+{
+    free (M->refs);
+    free (M->faults);
+    free (M->writebacks);
+    free (M->framepage);
+    free (M->rows);
+
+    M->refs = M->faults = M->writebacks = M->rows = NULL;
+    M->framepage = NULL;
+}
+
+// Start a new row of the image, making room if needed
+
+static void next_row (sheat * M)
+{
+    unsigned * rows;
+
+    M->rowpos = 0;
+
+    if (M->numrows+1 == M->maxrows)
+    {
+        rows = (unsigned*) realloc (M->rows, 2 * M->maxrows *
+                                    M->numbins * sizeof(unsigned));
+
+        // Without memory, the last row keeps accumulating
+        if (!rows)
+            return;
+
+        M->rows = rows;
+        memset (M->rows + M->maxrows*M->numbins, 0,
+                M->maxrows * M->numbins * sizeof(unsigned));
+        M->maxrows *= 2;
+    }
+
+    M->numrows ++;
+}
+
+void heat_reference (sheat * M, ssystem * S, unsigned addr,
+                     int faults, int writebacks)
+{
+    unsigned page = addr / S->pagsz;
+    int frame, old;
+
+    if (page >= M->numpags)  // Illegal reference
+        return;
+
+    M->refs[page] ++;
+
+    if (S->numpagefaults != faults)
+    {
+        M->faults[page] += S->numpagefaults - faults;
+        M->rows[M->numrows*M->numbins + page/M->binpages] +=
+            S->numpagefaults - faults;
+
+        // The page replaced is the one that left the frame
+        frame = PGT_FRAME (S, page);
+        old = M->framepage[frame];
+        M->framepage[frame] = page;
+
+        if (old>=0 && old!=page)
+            M->writebacks[old] += S->numpgwriteback - writebacks;
+    }
+
+    if (M->pgm && ++M->rowpos == M->rowrefs)
+        next_row (M);
+}
+
+static void write_csv (sheat * M, FILE * pf)
+{
+    unsigned refs, faults, writebacks;
+    int b, p;
+
+    fprintf (pf, "first_page,last_page,refs,faults,writebacks,"
+                 "fault_rate\n");
+
+    for (b=0; b<M->numbins; b++)
+    {
+        refs = faults = writebacks = 0;
+
+        for (p=b*M->binpages;
+             p<(b+1)*M->binpages && p<M->numpags; p++)
+        {
+            refs += M->refs[p];
+            faults += M->faults[p];
+            writebacks += M->writebacks[p];
+        }
+
+        fprintf (pf, "%d,%d,%u,%u,%u,%.6f\n", b*M->binpages,
+                 p-1, refs, faults, writebacks,
+                 refs ? (double) faults/refs : 0);
+    }
+}
+
+// Faults of each range in each row, in logarithmic scale from
+// 0 (none) to 255 (the most)
+
+static void write_pgm (sheat * M, FILE * pf)
+{
+    int numrows = M->numrows + (M->rowpos>0 || !M->numrows);
+    unsigned max = 0, i;
+
+    for (i=0; i<numrows*M->numbins; i++)
+        if (M->rows[i] > max)
+            max = M->rows[i];
+
+    fprintf (pf, "P5\n# Page faults: %d pages per column, "
+                 "%u references per row, max. %u\n%d %d\n255\n",
+             M->binpages, M->rowrefs, max, M->numbins, numrows);
+
+    for (i=0; i<numrows*M->numbins; i++)
+        fputc (max ? (int) (255 * log1p(M->rows[i]) / log1p(max) +
+                            0.5)
+                   : 0, pf);
+}
+
+// Ranges, by number of faults (the most first)
+
+typedef struct
+{
+    unsigned faults;
+    int bin;
+}
+sbin;
+
+static int compare_bins (const void * a, const void * b)
+{
+    const sbin * x = a, * y = b;
+
+    if (x->faults != y->faults)
+        return x->faults > y->faults ? -1 : 1;
+
+    return x->bin - y->bin;
+}
+
+int heat_report (sheat * M)
+{
+    sbin * bins;
+    unsigned total = 0, sum, refs, writebacks;
+    int b, p, i, half;
+    FILE * pf;
+
+    bins = (sbin*) calloc (M->numbins, sizeof(sbin));
+
+    if (!bins)
+        return -1;
+
+    for (b=0; b<M->numbins; b++)
+        bins[b].bin = b;
+
+    for (p=0; p<M->numpags; p++)
+    {
+        bins[p/M->binpages].faults += M->faults[p];
+        total += M->faults[p];
+    }
+
+    qsort (bins, M->numbins, sizeof(sbin), compare_bins);
+
+    printf ("Page faults by range of %d pages (%d ranges):\n\n",
+            M->binpages, M->numbins);
+    printf ("%10s %10s %12s %10s %7s %10s\n", "From", "To", "Refs",
+            "Faults", "%", "WBacks");
+
+    for (i=0; i<HEAT_TOP && i<M->numbins && bins[i].faults; i++)
+    {
+        b = bins[i].bin;
+        refs = writebacks = 0;
+
+        for (p=b*M->binpages;
+             p<(b+1)*M->binpages && p<M->numpags; p++)
+        {
+            refs += M->refs[p];
+            writebacks += M->writebacks[p];
+        }
+
+        printf ("%10d %10d %12u %10u %6.1f%% %10u\n",
+                b*M->binpages, p-1, refs, bins[i].faults,
+                100.0 * bins[i].faults / total, writebacks);
+    }
+
+    // Concentration: the fewest ranges with half the faults
+    for (half=0, sum=0; half<M->numbins && 2*sum<total; half++)
+        sum += bins[half].faults;
+
+    printf ("\nHalf of the page faults are in %d of %d ranges "
+            "(%.1f%%)\n", half, M->numbins,
+            100.0 * half / M->numbins);
+
+    free (bins);
+
+    pf = fopen (M->path, "w");
+
+    if (!pf)
+    {
+        perror ("ERROR creating the heat map");
+        return -1;
+    }
+
+    printf ("Heat map written to %s\n", M->path);
+
+    if (M->pgm)
+        write_pgm (M, pf);
+    else
+        write_csv (M, pf);
+
+    return fclose (pf)==0 ? 0 : -1;
+}
@@ -0,0 +1,66 @@
+/*
+    sim_heat.h
+*/
+
+#ifndef _SIM_HEAT_H_
+#define _SIM_HEAT_H_
+
+#include "sim_paging.h"
+
+// Heat map of the pages: the references, page faults and
+// write-backs of each page. The faults are attributed to the
+// page referenced, and the write-backs to the page that was
+// replaced, which is the previous page of the frame where the
+// fault loaded the new one (as seen here; with huge pages,
+// the subpages loaded by a promotion are not seen, so the
+// write-backs are only approximate).
+//
+// The pages are grouped in 'numbins' ranges of consecutive
+// pages. At the end there is a report with the ranges with
+// most faults, and the heat map is written to a file: as CSV,
+// with the totals of each range, or as a PGM image (if the
+// name ends with ".pgm"), with a row for every 'rowrefs'
+// references and a column for each range, whose intensity is
+// the number of faults, in logarithmic scale.
+
+#define HEAT_BINS     256     // Defaults
+#define HEAT_ROWREFS  10000
+
+typedef struct
+{
+    int numpags;                // Pages
+    unsigned * refs;            // References of each page
+    unsigned * faults;          // Page faults
+    unsigned * writebacks;      // Write-backs
+    int numframes;
+    int * framepage;            // Page of each frame
+
+    const char * path;          // Output file
+    int pgm;                    // 1 = PGM, 0 = CSV
+    int numbins;                // Ranges of pages
+    int binpages;               //  ... pages in each one
+
+    unsigned rowrefs;           // References per row of PGM
+    unsigned rowpos;            //  ... in the current row
+    unsigned * rows;            // Faults of each range in
+    int numrows, maxrows;       //  ... each row
+}
+sheat;
+
+// Reserve the counters (0 = OK, -1 = no memory)
+
+int heat_init (sheat * M, ssystem * S, const char * path,
+               int numbins, unsigned rowrefs);
+void heat_free (sheat * M);
+
+// Take note of a reference that has just been simulated;
+// 'faults' and 'writebacks' are the counters of S before it
+
+void heat_reference (sheat * M, ssystem * S, unsigned addr,
+                     int faults, int writebacks);
+
+// Print the report and write the file (0 = OK, -1 = error)
+
+int heat_report (sheat * M);
+
+#endif // _SIM_HEAT_H_
@@ -0,0 +1,296 @@
+/*
+    sim_hugepages.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_hugepages.h"
+
+static void note_load (shugepages * H, ssystem * S, int page);
+static void note_eviction (shugepages * H, ssystem * S, int page);
+static void promote (shugepages * H, ssystem * S, int region);
+static void demote (shugepages * H, ssystem * S, int region);
+static void mark_accessed (shugepages * H, ssystem * S, int region);
+
+int huge_init (shugepages * H, ssystem * S, int factor,
+               int threshold, int tlbbase, int tlbhuge)
+{
+    memset (H, 0, sizeof(*H));
+
+    H->factor = factor;
+    H->threshold = threshold;
+
+    // Only the regions that are complete can be promoted
+    // (a huge page can't go beyond the end of the array)
+    H->numregions = factor>1 ? S->numpags/factor : 0;
+
+    H->promoted = (char*) calloc (H->numregions+1, 1);
+    H->numtouched = (int*) calloc (H->numregions+1, sizeof(int));
+    H->touched = (char*) calloc (S->numpags, 1);
+    H->framepage = (int*) malloc (S->numframes*sizeof(int));
+
+    if (!H->promoted || !H->numtouched || !H->touched ||
+        !H->framepage ||
+        tlb_init(&H->tlbbase,tlbbase)<0 ||
+        tlb_init(&H->tlbhuge,tlbhuge)<0)
+    {
+        huge_free (H);
+        return -1;
+    }
+
+    memset (H->framepage, -1, S->numframes*sizeof(int));
+
+    return 0;
+}
+
+void huge_free (shugepages * H)
+{
+    free (H->promoted);
+    free (H->numtouched);
+    free (H->touched);
+    free (H->framepage);
+    tlb_free (&H->tlbbase);
+    tlb_free (&H->tlbhuge);
+
+    H->promoted = NULL;
+    H->numtouched = NULL;
+    H->touched = NULL;
+    H->framepage = NULL;
+}
+
+unsigned huge_reference (shugepages * H, ssystem * S,
+                         unsigned virt_address, char op)
+{
+    unsigned physical_addr, faults;
+    int page, region;
+
+    page = virt_address / S->pagsz;
+
+    if (page >= S->numpags)       // Let the MMU count
+        return sim_mmu (S, virt_address, op);  // it as illegal
+
+    region = page / H->factor;
+
+    // Translation: huge pages are looked up in their own TLB
+
+    if (region < H->numregions && H->promoted[region])
+    {
+        H->numhugerefs ++;
+
+        if (!tlb_lookup(&H->tlbhuge, region))
+            mark_accessed (H, S, region);
+    }
+    else
+        tlb_lookup (&H->tlbbase, page);
+
+    faults = S->numpagefaults;
+    physical_addr = sim_mmu (S, virt_address, op);
+
+    if (S->numpagefaults != faults)
+    {
+        // The subpages of a huge page are always resident,
+        // so this must have been a fault on a base page
+        H->numbasefaults ++;
+        note_load (H, S, page);
+    }
+
+    if (!H->touched[page])
+    {
+        H->touched[page] = 1;
+
+        if (region < H->numregions)
+        {
+            H->numtouched[region] ++;
+
+            if (H->promoted[region])
+                H->wasted --;
+            else if (H->numtouched[region] >= H->threshold)
+                promote (H, S, region);
+        }
+    }
+
+    H->numrefs ++;
+    H->sumwasted += H->wasted;
+
+    return physical_addr;
+}
+
+// A page has just been loaded in a frame: whatever was in
+// that frame before has been evicted
+
+static void note_load (shugepages * H, ssystem * S, int page)
+{
+    int frame, old;
+
+    frame = PGT_FRAME(S,page);
+    old = H->framepage[frame];
+    H->framepage[frame] = page;
+    H->touched[page] = 0;
+
+    if (old!=-1 && old!=page)
+        note_eviction (H, S, old);
+}
+
+static void note_eviction (shugepages * H, ssystem * S, int page)
+{
+    int region;
+
+    tlb_invalidate (&H->tlbbase, page);
+
+    region = page / H->factor;
+
+    if (region < H->numregions)
+    {
+        if (H->promoted[region])
+            demote (H, S, region);
+
+        if (H->touched[page])
+            H->numtouched[region] --;
+    }
+
+    H->touched[page] = 0;
+}
+
+static void promote (shugepages * H, ssystem * S, int region)
+{
+    int first, page, loaded;
+    unsigned faults;
+
+    // A huge page must fit in physical memory
+    if (H->factor > S->numframes)
+        return;
+
+    if (S->detailed)
+        printf ("@ Promoting region %d (P%d-P%d) to a huge page\n",
+                region, region*H->factor,
+                (region+1)*H->factor-1);
+
+    first = region * H->factor;
+
+    // Load the subpages that are not resident yet. The OS
+    // brings them in at once (one huge page fault), though
+    // the policy still has to find a frame for each one
+
+    for (page=first, loaded=0; page<first+H->factor; page++)
+        if (!PGT_PRESENT(S,page))
+        {
+            faults = S->numpagefaults;
+            handle_page_fault (S, page*S->pagsz);
+
+            if (S->numpagefaults != faults)
+            {
+                note_load (H, S, page);
+                loaded ++;
+            }
+        }
+
+    H->numprefetched += loaded;
+
+    // Making room for some subpages might have evicted others
+    // of the same region; if so, give up
+
+    for (page=first; page<first+H->factor; page++)
+        if (!PGT_PRESENT(S,page))
+        {
+            if (S->detailed)
+                printf ("@ Promotion of region %d aborted\n", region);
+            return;
+        }
+
+    if (loaded)
+        H->numhugefaults ++;
+
+    // One huge TLB entry replaces the base page entries
+    for (page=first; page<first+H->factor; page++)
+        tlb_invalidate (&H->tlbbase, page);
+
+    H->promoted[region] = 1;
+    H->numpromotions ++;
+
+    if (++H->numhugepages > H->maxhugepages)
+        H->maxhugepages = H->numhugepages;
+
+    H->wasted += H->factor - H->numtouched[region];
+
+    if (H->wasted > H->maxwasted)
+        H->maxwasted = H->wasted;
+
+    mark_accessed (H, S, region);
+}
+
+static void demote (shugepages * H, ssystem * S, int region)
+{
+    if (S->detailed)
+        printf ("@ Demoting huge page of region %d\n", region);
+
+    tlb_invalidate (&H->tlbhuge, region);
+
+    H->promoted[region] = 0;
+    H->numdemotions ++;
+    H->numhugepages --;
+    H->wasted -= H->factor - H->numtouched[region];
+}
+
+// A huge page has a single accessed bit for all its subpages,
+// which the hardware sets when it loads the translation in the
+// TLB. Pass it on to the subpages, so that the replacement
+// policy sees all of them as recently used. This is neither a
+// read nor a write, so it must not change the counters nor the
+// modified bits.
+
+static void mark_accessed (shugepages * H, ssystem * S, int region)
+{
+    int page;
+
+    for (page=region*H->factor; page<(region+1)*H->factor; page++)
+        reference_page (S, page, 'A');
+}
+
+// Function that shows the results, per page size
+
+void print_huge_report (shugepages * H, ssystem * S,
+                        unsigned totelem)
+{
+    unsigned hugesz;
+
+    hugesz = H->factor * S->pagsz;
+
+    printf ("%-28s %12s %12s\n", "", "Base", "Huge");
+    printf ("%-28s %12d %12u\n", "Page size (elements):",
+            S->pagsz, hugesz);
+    printf ("%-28s %12u %12u\n", "References:",
+            H->numrefs-H->numhugerefs, H->numhugerefs);
+    printf ("%-28s %12u %12u\n", "Page faults:",
+            H->numbasefaults, H->numhugefaults);
+    printf ("%-28s %12u %12u\n", "Pages loaded:",
+            H->numbasefaults, H->numprefetched);
+    printf ("%-28s %12d %12d\n", "TLB entries:",
+            H->tlbbase.numentries, H->tlbhuge.numentries);
+    printf ("%-28s %12u %12u\n", "TLB reach (elements):",
+            H->tlbbase.numentries*S->pagsz,
+            H->tlbhuge.numentries*hugesz);
+    printf ("%-28s %12u %12u\n", "TLB hits:",
+            H->tlbbase.numhits, H->tlbhuge.numhits);
+    printf ("%-28s %12u %12u\n", "TLB misses:",
+            H->tlbbase.nummisses, H->tlbhuge.nummisses);
+
+    printf ("\nPromotions:                  %12u\n",
+            H->numpromotions);
+    printf ("Demotions:                   %12u\n",
+            H->numdemotions);
+    printf ("Huge pages (now/peak):       %12u %12u\n",
+            H->numhugepages, H->maxhugepages);
+
+    // Internal fragmentation, in elements. Base pages only
+    // waste the tail of the last page; huge pages waste the
+    // subpages that were loaded but never touched
+
+    printf ("\nInternal fragmentation (elements):\n");
+    printf ("  Base pages:                %12u\n",
+            S->numpags*S->pagsz - totelem);
+    printf ("  Huge pages (now/peak/avg): %12u %12u %12.1f\n",
+            H->wasted*S->pagsz, H->maxwasted*S->pagsz,
+            H->numrefs ? H->sumwasted*S->pagsz/H->numrefs : 0.0);
+}
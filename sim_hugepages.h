@@ -0,0 +1,73 @@
+/*
+    sim_hugepages.h
+*/
+
+#ifndef _SIM_HUGEPAGES_H_
+#define _SIM_HUGEPAGES_H_
+
+#include "sim_paging.h"
+#include "sim_tlb.h"
+
+// Mixed page sizes: every aligned group of 'factor' base
+// pages (a "region") can be promoted to a huge page when
+// enough of its subpages have been touched, in the manner of
+// transparent huge pages (THP). A promoted region keeps all
+// its subpages resident and is translated by a single huge
+// TLB entry. When the replacement policy evicts any of its
+// subpages, the region is demoted (split) back to base pages.
+//
+// The replacement policies still work with base pages and
+// frames; this layer sits between the trace and sim_mmu,
+// loading the missing subpages on promotion and watching the
+// frames table to find out which pages get evicted.
+
+typedef struct
+{
+    int factor;             // Base pages per huge page
+    int threshold;          // Touched subpages to promote
+    int numregions;         // Regions that can be promoted
+    char * promoted;        // 1 = region is a huge page
+    int * numtouched;       // Resident and touched subpages
+    char * touched;         // 1 = base page touched since loaded
+    int * framepage;        // Last page seen in each frame
+
+    stlb tlbbase;           // TLB entries for base pages
+    stlb tlbhuge;           // TLB entries for huge pages
+
+    // Counters
+    unsigned numbasefaults;   // Faults on base pages
+    unsigned numhugefaults;   // Promotions that had to load
+                              // missing subpages
+    unsigned numprefetched;   // Subpages loaded by those
+    unsigned numpromotions;   // Regions promoted
+    unsigned numdemotions;    // Regions split by eviction
+    unsigned numhugerefs;     // References to huge pages
+    unsigned numhugepages;    // Regions currently promoted
+    unsigned maxhugepages;    // Peak of numhugepages
+
+    // Internal fragmentation of the huge pages: resident
+    // subpages that have not been touched since loaded
+    unsigned wasted;          // Current number of them
+    unsigned maxwasted;       // Peak
+    double sumwasted;         // Sum over references (average)
+    unsigned numrefs;         // References seen
+}
+shugepages;
+
+// Reserve the tables (0 = OK, -1 = not enough memory)
+
+int huge_init (shugepages * H, ssystem * S, int factor,
+               int threshold, int tlbbase, int tlbhuge);
+void huge_free (shugepages * H);
+
+// Simulate one memory access, instead of calling sim_mmu
+
+unsigned huge_reference (shugepages * H, ssystem * S,
+                         unsigned virt_address, char op);
+
+// Show the results, per page size
+
+void print_huge_report (shugepages * H, ssystem * S,
+                        unsigned totelem);
+
+#endif // _SIM_HUGEPAGES_H_
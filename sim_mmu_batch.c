@@ -0,0 +1,135 @@
+/*
+    sim_mmu_batch.c
+*/
+
+#include "sim_paging.h"
+#include "sim_stats.h"
+
+// Translation of a batch of references. It does the same as
+// calling sim_mmu for each one, but the references to pages
+// that are present (the vast majority with a reasonable number
+// of frames) only go through reference_page, where the
+// replacement policy does its bookkeeping on every access. So
+// the hits don't run sim_mmu: the simulators only use it with
+// -B, once sim_mmu is known to be right.
+//
+// Each block of addresses is done in two passes without
+// branches nor divisions, which the compiler can vectorize
+// (this file is compiled with -O3). The first one splits them
+// into page and offset, with a shift if the page size is a
+// power of 2 and a multiplication by its reciprocal otherwise.
+// The second one takes the presence of each page from the
+// bitmap of the page table, 32 pages per word, instead of
+// loading its whole entry. Then the hits go to reference_page,
+// and only the pages that are missing, or out of range, go
+// through sim_mmu. A fault may replace a page of the rest of
+// the block, so after the first one their bits are read again.
+
+#define BLOCK 256   // Addresses split at once
+
+// Constants to divide by the page size d (Granlund and
+// Montgomery, "Division by invariant integers using
+// multiplication", fig. 4.1): with l = ceil(log2(d)),
+//
+//   t = (m * a) >> 32,  q = (t + ((a - t) >> sh1)) >> sh2
+//
+// gives a / d for any 32-bit a. A power of 2 is just a shift.
+
+typedef struct
+{
+    unsigned pow2;        // 1 = power of 2
+    unsigned m, sh1, sh2; // Multiplier and shifts
+}
+sdivisor;
+
+static void make_divisor (sdivisor * D, unsigned d)
+{
+    unsigned l;
+
+    for (l=0; (1ULL<<l) < d; l++)
+        ;
+
+    D->pow2 = (1ULL<<l) == d;
+    D->m = ((1ULL<<32) * ((1ULL<<l) - d)) / d + 1;
+    D->sh1 = l<1 ? l : 1;
+    D->sh2 = l<1 ? 0 : l-1;
+
+    if (D->pow2)
+        D->sh2 = l;
+}
+
+void sim_mmu_batch (ssystem * S, const unsigned addrs[],
+                    const char ops[], unsigned n,
+                    unsigned physaddrs[])
+{
+    sdivisor D;
+    const unsigned * present = PGT_PRESENT_BITMAP (S);
+    unsigned pages[BLOCK], hits[BLOCK], numpags = S->numpags,
+             i, j, m, a, t, in, p, page, phys, faulted;
+
+    // Step by step, every access is shown by sim_mmu
+    if (S->detailed)
+    {
+        for (i=0; i<n; i++)
+        {
+            phys = sim_mmu (S, addrs[i], ops[i]);
+
+            if (physaddrs)
+                physaddrs[i] = phys;
+        }
+
+        return;
+    }
+
+    make_divisor (&D, S->pagsz);
+
+    for (i=0; i<n; i+=m)
+    {
+        m = n-i<BLOCK ? n-i : BLOCK;
+
+        // Pages of the block
+        if (D.pow2)
+            for (j=0; j<m; j++)
+                pages[j] = addrs[i+j] >> D.sh2;
+        else
+            for (j=0; j<m; j++)
+            {
+                a = addrs[i+j];
+                t = ((unsigned long long) a * D.m) >> 32;
+                pages[j] = (t + ((a-t) >> D.sh1)) >> D.sh2;
+            }
+
+        // Presence of the pages of the block (those out of
+        // range look at page 0, and are not hits anyway)
+        for (j=0; j<m; j++)
+        {
+            in = pages[j] < numpags;
+            p = pages[j] & -in;
+            hits[j] = in & (present[PGT_WORD(p)] >> (p&31));
+        }
+
+        for (j=0, faulted=0; j<m; j++)
+        {
+            page = pages[j];
+
+            if (hits[j] && (!faulted || PGT_GET_BIT(present,page)))
+            {
+                reference_page (S, page, ops[i+j]);
+
+                if (physaddrs)
+                    physaddrs[i+j] = PGT_FRAME(S,page) * S->pagsz +
+                                     addrs[i+j] - page * S->pagsz;
+            }
+            else
+            {
+                STATS_ENTER (STATS_FAULT);
+                phys = sim_mmu (S, addrs[i+j], ops[i+j]);
+                STATS_ENTER (STATS_MMU);
+                faulted = 1;
+
+                if (physaddrs)
+                    physaddrs[i+j] = phys;
+            }
+        }
+    }
+}
@@ -5,8 +5,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "sim_paging.h"
+#include "sim_hugepages.h"
+#include "sim_cost.h"
+#include "sim_stats.h"
+#include "sim_phases.h"
+#include "sim_heat.h"
+#include "trace.h"
+#include "trace_cache.h"
 
 // Structure holding data of the parameters passed through
 // the command line (algorithm to be used etc.)
@@ -17,6 +25,33 @@ typedef struct
     const char * algorithm, * initialstate;
     int numelem;
     char detailed;
+
+    // Mixed page sizes (hugefactor 0 = base pages only, and
+    // no TLB)
+    int hugefactor, hugethreshold;
+    char hugereport;        // 1 = -H given: report the sizes
+    int tlbbase, tlbhuge;
+
+    // Cost model
+    char costmodel;         // 1 = estimate the execution time
+    double latencies[4];    // Memory, TLB, read, write (ns)
+    const char * device;    // Storage device (NULL = none)
+
+    // Interval mode (interval 0 = no)
+    unsigned interval;      // References per interval
+    double lambda;          // Threshold of a change of phase
+
+    // Heat map (heatfile NULL = no)
+    const char * heatfile;  // Output, CSV or PGM
+    int heatbins;           // Ranges of pages
+    unsigned heatrowrefs;   // References per row of PGM
+
+    const char * tracefile; // Replay this file (NULL = run
+                            // gen_trace)
+    unsigned seed;          // Seed for gen_trace
+    unsigned policyseed;    // Seed of the random replacement
+    int batch;              // 1 = references in batches (the
+                            // hits don't go through sim_mmu)
 }
 sparameters;
 
@@ -25,59 +60,95 @@ sparameters;
 
 int parse_command (int, char*[], sparameters*);
 
+// With -B, references are passed to sim_mmu_batch in groups of
+// these
+
+#define BATCH_SIZE 1024
+
 // Main function
 
 int main (int argc, char * argv[])
 {
     sparameters P;      // Parameters received in the command line
-    char command[100];  // Command for executing gen_trace
-    FILE * pipe;        // Communication channel with gen_trace
-    int ok;             // Flag
+    char source[FILENAME_MAX];  // Cached trace (or command)
+    strace T;           // Trace being read
+    int ok, hit;        // Flags
     char op;            // Elementary operation ('R'ead, 'W'ri..)
     unsigned u;         // Number of the read/written element
     unsigned numpags;   // Total number of pages
     unsigned totelem;   // Total num. of elements (double in MER)
     ssystem S;          // State of the whole simulated system
+    shugepages H;       // State of the huge pages and TLB
+    scost C;            // Simulated time
+    unsigned faults, writebacks, tlbmisses;
+    unsigned batch[BATCH_SIZE]; // References not simulated yet
+    char batchops[BATCH_SIZE];  //  ... and their operations
+    unsigned numbatch = 0;
+    sphases I;          // Interval mode
+    sheat M;            // Heat map
+    unsigned numinterval = 0;  // References in the interval
 
     memset (&S, 0, sizeof(S));  // Reset system
+    memset (&H, 0, sizeof(H));
+    memset (&C, 0, sizeof(C));
+    memset (&M, 0, sizeof(M));
 
     if (parse_command(argc,argv,&P)<0)  // Put parameters in P
         return -1;
 
-    printf ("# Parameters:  %s %i %i %s %s %i %c\n",
-            argv[0], P.pagsz, P.numframes,
-            P.algorithm, P.initialstate, P.numelem,
-            P.detailed?'D':'N');
-
-    // Prepare command for invoking gen_trace
-    // (sprintf "prints" in a string)
-    sprintf (command, "./gen_trace %s %s %u",
-                      P.algorithm, P.initialstate, P.numelem);
+    STATS_INIT (&S);
 
-    printf ("# Executing command:  %s\n", command);
+    if (P.tracefile)
+    {
+        printf ("# Parameters:  %s %i %i %c\n",
+                argv[0], P.pagsz, P.numframes,
+                P.detailed?'D':'N');
 
-    // Invoke gen_trace and open a pipe to read
-    // its standard output ("r" stands for read)
-    pipe = popen (command, "r");
+        printf ("# Reading trace:  %s\n", P.tracefile);
 
-    if (!pipe)
+        // Map the file in memory and read the total # of
+        // elements
+        if (trace_open_file(&T,P.tracefile)<0)
+        {
+            perror ("ERROR while opening the trace");
+            return -1;
+        }
+    }
+    else
     {
-        perror ("ERROR while starting gen_trace");
-        return -1;
+        printf ("# Parameters:  %s %i %i %s %s %i %c\n",
+                argv[0], P.pagsz, P.numframes,
+                P.algorithm, P.initialstate, P.numelem,
+                P.detailed?'D':'N');
+
+        // Take the trace from the cache, or generate it by
+        // invoking gen_trace
+        hit = trace_cache_open (&T, P.algorithm, P.initialstate,
+                                P.numelem, P.seed,
+                                source, sizeof(source));
+
+        if (hit<0)
+        {
+            perror ("ERROR while starting gen_trace");
+            return -1;
+        }
+
+        printf ("# Trace:  %s (%s)\n", source,
+                hit ? "cached" : "generated");
     }
 
-    // Read total # of elements to be sorted
-    ok = fscanf (pipe," T %u", &totelem) == 1;
+    totelem = T.totelem;
+    ok = totelem > 0;
 
     if (ok)
     {
         // Calculate total number of pages
         numpags = (totelem+P.pagsz-1) / P.pagsz; 
 
-        S.pgt = (spage*) malloc (numpags*sizeof(spage));
+        S.numpags = numpags;
         S.frt = (sframe*) malloc (P.numframes*sizeof(sframe));
 
-        if (!S.pgt || !S.frt)
+        if (alloc_page_table(&S)<0 || !S.frt)
         {
             fprintf (stderr,
                      "ERROR: not enough "
@@ -89,44 +160,187 @@ int main (int argc, char * argv[])
     if (ok)
     {
         S.pagsz = P.pagsz;
-        S.numpags = numpags;
         S.numframes = P.numframes;
         S.detailed = P.detailed;
+        xoshiro_seed (&S.random, P.policyseed);
 
         init_tables (&S);
+
+        if (P.hugefactor &&
+            huge_init(&H, &S, P.hugefactor, P.hugethreshold,
+                      P.tlbbase, P.tlbhuge)<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+
+        if (P.costmodel &&
+            cost_init(&C, P.device,
+                      P.latencies[0], P.latencies[1],
+                      P.latencies[2], P.latencies[3])<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+
+        if (P.heatfile &&
+            heat_init(&M, &S, P.heatfile, P.heatbins,
+                      P.heatrowrefs)<0)
+        {
+            fprintf (stderr,
+                     "ERROR: not enough "
+                            "dynamic memory\n");
+            ok = 0;
+        }
+
+        if (ok && P.interval)
+            phases_init (&I, P.interval, P.lambda, &S);
     }
 
+    STATS_ENTER (STATS_TRACE);
+
     while (ok)
     {
-        // Ignore spaces and read one character
-        if (fscanf(pipe," %c",&op)!=1)
+        STATS_POLL ();
+
+        // Read one operation (and the element, if R/W)
+        if (trace_next(&T,&op,&u)!=1)
         {
             ok = 0;
             break;
         }
 
         if (op=='R' || op=='W')              // If R/W,
-        {                                    // take element
-            if (fscanf(pipe,"%u",&u)!=1)     // number and
-                ok = 0;                      // annotate
+        {                                    // annotate
+            faults = S.numpagefaults;
+            writebacks = S.numpgwriteback;
+
+            if (P.costmodel)
+            {
+                STATS_ENTER (STATS_MMU);
+
+                tlbmisses = H.tlbbase.nummisses +
+                            H.tlbhuge.nummisses;
+
+                huge_reference (&H, &S, u, op);
+
+                cost_reference (&C,
+                                H.tlbbase.nummisses +
+                                H.tlbhuge.nummisses - tlbmisses,
+                                S.numpagefaults - faults,
+                                S.numpgwriteback - writebacks);
+
+                STATS_ENTER (STATS_TRACE);
+            }
+            else if (P.hugefactor)
+            {
+                STATS_ENTER (STATS_MMU);
+                huge_reference (&H, &S, u, op);
+                STATS_ENTER (STATS_TRACE);
+            }
+            else if (P.batch && !P.heatfile)
+            {
+                batch[numbatch] = u;
+                batchops[numbatch] = op;
+                numbatch ++;
+            }
             else
-                sim_mmu (&S, u, op);  // Simulate memory access
+            {
+                // One by one (the heat map needs the faults of
+                // each page)
+                STATS_ENTER (STATS_MMU);
+                sim_mmu (&S, u, op);
+                STATS_ENTER (STATS_TRACE);
+            }
+
+            if (P.heatfile)
+                heat_reference (&M, &S, u, faults, writebacks);
+
+            numinterval ++;
+
+            // The batch is simulated when it's full, and at the
+            // end of each interval
+            if (numbatch==BATCH_SIZE ||
+                (numbatch && P.interval && numinterval==P.interval))
+            {
+                // Simulate memory accesses
+                STATS_ENTER (STATS_MMU);
+                sim_mmu_batch (&S, batch, batchops,
+                               numbatch, NULL);
+                STATS_ENTER (STATS_TRACE);
+                numbatch = 0;
+            }
+
+            if (P.interval && numinterval==P.interval)
+            {
+                phases_interval (&I, &S, numinterval);
+                numinterval = 0;
+            }
         }
         else if (op=='S')        // 'S'orted -> end
-            break;               // 'C'omparison -> go on
+        {
+            STATS_ENTER (STATS_MMU);
+            sim_mmu_batch (&S, batch, batchops, numbatch, NULL);
+
+            if (P.interval)
+            {
+                if (numinterval)
+                    phases_interval (&I, &S, numinterval);
+
+                phases_end (&I);
+            }
+            break;
+        }                        // 'C'omparison -> go on
         else if (op!='C')        // 'O'ut of order (or
             ok = 0;              // something else) -> error
     }
 
+    STATS_ENTER (STATS_REPORT);
+
     if (ok)
+    {
         print_report (&S);
 
+        if (P.hugereport)
+        {
+            printf ("---------- PAGE SIZES REPORT ----------\n\n");
+            print_huge_report (&H, &S, totelem);
+            printf ("\n");
+        }
+
+        if (P.costmodel)
+        {
+            printf ("---------- TIME REPORT ----------\n\n");
+            print_cost_report (&C);
+            printf ("\n");
+        }
+
+        if (P.heatfile)
+        {
+            printf ("---------- HEAT MAP REPORT ----------\n\n");
+
+            if (heat_report(&M)<0)
+                ok = 0;
+
+            printf ("\n");
+        }
+    }
+
+    STATS_DUMP ();
+
     // Wait until gen_trace ends and close
-    if (pclose(pipe)==-1)
+    if (trace_close(&T)<0)
         ok = 0;
 
     // Free dynamic memory
-    free (S.pgt);
+    huge_free (&H);
+    cost_free (&C);
+    heat_free (&M);
+    free_page_table (&S);
     free (S.frt);
 
     return ok ? 0 : -1;
@@ -167,12 +381,16 @@ void print_report (ssystem * S)
 // Function that parses the parameters received through the
 // command line:
 
-#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP"
-#define VALID_INIT_ORD "ASC/DES/RAN"
+#define VALID_ALGORITHMS "BUB/INS/SEL/HEA/COM/MER/QUI/QRP/" \
+                         "HE4/HE8/HEB/NAT/TIM/BIT/LSD/MSD/CNT/" \
+                         "MMN/MMB/HJN/BTR/BFS"
+#define VALID_INIT_ORD "ASC/DES/RAN/NEA/FEW/SAW/ORG/ZIP/RUN/ADV"
 
 int parse_command (int argc, char * argv[], sparameters * p)
 {
-    int ok;
+    int ok, opt, n, modearg;
+    const char * name = argv[0];
+    char * comma;
 
     // Default parameters
     p->pagsz = 16;
@@ -181,8 +399,184 @@ int parse_command (int argc, char * argv[], sparameters * p)
     p->initialstate = "RAN";
     p->numelem = 1000;
     p->detailed = 0;
+    p->hugefactor = 0;
+    p->hugethreshold = 0;
+    p->hugereport = 0;
+    p->tlbbase = 64;
+    p->tlbhuge = 32;
+    p->costmodel = 0;
+    p->latencies[0] = p->latencies[1] = -1;
+    p->latencies[2] = p->latencies[3] = -1;
+    p->device = NULL;
+    p->interval = 0;
+    p->lambda = PHASES_LAMBDA;
+    p->heatfile = NULL;
+    p->heatbins = HEAT_BINS;
+    p->heatrowrefs = HEAT_ROWREFS;
+    p->tracefile = NULL;
+    p->seed = 0;
+    p->policyseed = 0;
+    p->batch = 0;
+
+    // Options, before the positional parameters
+
+    ok = 1;
+
+    while ((opt = getopt(argc, argv, "H:p:t:T:L:D:I:M:f:s:r:B")) != -1)
+        switch (opt)
+        {
+            case 'H':
+                if (sscanf(optarg,"%d",&p->hugefactor)!=1 ||
+                    p->hugefactor<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong huge page factor");
+                    ok = 0;
+                }
+                p->hugereport = 1;
+                break;
+
+            case 'p':
+                if (sscanf(optarg,"%d",&p->hugethreshold)!=1 ||
+                    p->hugethreshold<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong promotion threshold");
+                    ok = 0;
+                }
+                break;
+
+            case 't':
+                if (sscanf(optarg,"%d",&p->tlbbase)!=1 ||
+                    p->tlbbase<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of TLB entries");
+                    ok = 0;
+                }
+                break;
+
+            case 'T':
+                if (sscanf(optarg,"%d",&p->tlbhuge)!=1 ||
+                    p->tlbhuge<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong number of TLB entries");
+                    ok = 0;
+                }
+                break;
+
+            case 'L':
+                if (sscanf(optarg,"%lf,%lf,%lf,%lf",
+                           &p->latencies[0], &p->latencies[1],
+                           &p->latencies[2], &p->latencies[3])<1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong latencies");
+                    ok = 0;
+                }
+                p->costmodel = 1;
+                break;
+
+            case 'D':
+                if ((strncmp(optarg,"ssd",3) &&
+                     strncmp(optarg,"hdd",3)) ||
+                    (optarg[3] &&
+                     (sscanf(optarg+3,":%d",&n)!=1 || n<1)))
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong storage device");
+                    ok = 0;
+                }
+                p->device = optarg;
+                p->costmodel = 1;
+                break;
+
+            case 'I':
+                n = sscanf (optarg, "%u,%lf", &p->interval,
+                            &p->lambda);
+
+                if (n<1 || p->interval<1 || p->lambda<=0)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong interval");
+                    ok = 0;
+                }
+                break;
+
+            case 'M':
+                // file[,bins[,rowrefs]]: cut the name
+                p->heatfile = optarg;
+                comma = strchr (optarg, ',');
+
+                if (comma)
+                {
+                    *comma = '\0';
+                    n = sscanf (comma+1, "%d,%u", &p->heatbins,
+                                &p->heatrowrefs);
+
+                    if (n<1 || p->heatbins<1 || p->heatrowrefs<1)
+                    {
+                        fprintf (stderr,
+                                 "\n    ERROR: wrong heat map");
+                        ok = 0;
+                    }
+                }
+                break;
+
+            case 'f':
+                p->tracefile = optarg;
+                break;
+
+            case 's':
+                if (sscanf(optarg,"%u",&p->seed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed");
+                    ok = 0;
+                }
+                break;
+
+            case 'B':
+                p->batch = 1;
+                break;
+
+            case 'r':
+                if (sscanf(optarg,"%u",&p->policyseed)!=1)
+                {
+                    fprintf (stderr,
+                             "\n    ERROR: wrong seed of the policy");
+                    ok = 0;
+                }
+                break;
+
+            default:
+                ok = 0;
+        }
 
-    if (argc>7)
+    // The cost model needs the TLB, which comes with the huge
+    // pages (of a factor 1, without -H: only base pages, and
+    // nothing to report about their sizes)
+    if (p->costmodel && !p->hugefactor)
+        p->hugefactor = 1;
+
+    // By default, promote when half of the subpages are touched
+    if (!p->hugethreshold)
+        p->hugethreshold = p->hugefactor>1 ? p->hugefactor/2 : 1;
+
+    if (p->hugethreshold > p->hugefactor && p->hugefactor)
+    {
+        fprintf (stderr,
+                 "\n    ERROR: promotion threshold greater "
+                              "than huge page factor");
+        ok = 0;
+    }
+
+    // Skip the options: the positional parameters follow
+    argc -= optind-1;
+    argv += optind-1;
+
+    if (argc>7 || (p->tracefile && argc>4))
     {
         fprintf (stderr,
                  "\n    ERROR: too many parameters");
@@ -190,8 +584,6 @@ int parse_command (int argc, char * argv[], sparameters * p)
     }
     else
     {
-        ok = 1;
-
         if (argc>1 && (sscanf(argv[1],"%d",&p->pagsz)!=1 ||
                        p->pagsz<1))
         {
@@ -208,7 +600,11 @@ int parse_command (int argc, char * argv[], sparameters * p)
             ok = 0;
         }
 
-        if (argc>3)
+        // With a trace file, the mode comes right after the
+        // number of frames (there is no gen_trace to run)
+        modearg = p->tracefile ? 3 : 6;
+
+        if (argc>3 && !p->tracefile)
             p->algorithm = argv[3];
 
         if (strlen(p->algorithm)!=3 ||
@@ -220,7 +616,7 @@ int parse_command (int argc, char * argv[], sparameters * p)
             ok = 0;
         }
 
-        if (argc>4)
+        if (argc>4 && !p->tracefile)
             p->initialstate = argv[4];
 
         if (strlen(p->initialstate)!=3 ||
@@ -232,8 +628,9 @@ int parse_command (int argc, char * argv[], sparameters * p)
             ok = 0;
         }
 
-        if (argc>5 && (sscanf(argv[5],"%d",&p->numelem)!=1 ||
-                       p->numelem<2))
+        if (argc>5 && !p->tracefile &&
+            (sscanf(argv[5],"%d",&p->numelem)!=1 ||
+             p->numelem<2))
         {
             fprintf (stderr,
                      "\n    ERROR: wrong number of "
@@ -241,16 +638,17 @@ int parse_command (int argc, char * argv[], sparameters * p)
             ok = 0;
         }
 
-        if (argc>6)
+        if (argc>modearg)
         {
-            if (strcmp(argv[6],"N") && strcmp(argv[6],"D"))
+            if (strcmp(argv[modearg],"N") &&
+                strcmp(argv[modearg],"D"))
             {
                 fprintf (stderr,
                          "\n    ERROR: wrong mode");
                 ok = 0;
             }
 
-            p->detailed = !strcmp(argv[6],"D");
+            p->detailed = !strcmp(argv[modearg],"D");
         }
     }
 
@@ -258,25 +656,60 @@ int parse_command (int argc, char * argv[], sparameters * p)
         return 0;
 
     fprintf (stderr,
-             "\n\n    USAGE:\n\t%s pagesize numframes alg "
-                          "initord numelem mode\n\n", argv[0]);
+             "\n\n    USAGE:\n\t%s [options] pagesize numframes alg "
+                          "initord numelem mode\n"
+             "\t%s [options] -f trace pagesize numframes mode\n\n",
+             name, name);
 
     fprintf (stderr,
              "\tpagesize: # of elements that fit in a page\n"
              "\tnumframes: # of page frames (physical mem.)\n"
-             "\talg: sorting algorithm (%s)\n"
+             "\talg: sorting algorithm or workload (%s)\n"
              "\tinitord: initial state of the array (%s)\n"
              "\tnumelem: # of elements to be sorted\n"
              "\tmode: normal(N) or detailed(D)\n"
              "\n",
              VALID_ALGORITHMS, VALID_INIT_ORD);
 
+    fprintf (stderr,
+             "    OPTIONS:\n"
+             "\t-H factor: simulate huge pages of factor base pages\n"
+             "\t           (1 = only base pages, but report the TLB)\n"
+             "\t-p touched: subpages touched to promote a region\n"
+             "\t            (default: half of them)\n"
+             "\t-t entries: TLB entries for base pages (64)\n"
+             "\t-T entries: TLB entries for huge pages (32)\n"
+             "\t-L mem,tlb,read,write: latencies in ns of a memory\n"
+             "\t           access, a TLB miss, a page read and a\n"
+             "\t           write-back, and estimate the time\n"
+             "\t-D device[:depth]: send the I/O through a queue\n"
+             "\t           of a ssd (depth 32) or hdd (depth 1)\n"
+             "\t-I refs[,lambda]: print the faults, write-backs\n"
+             "\t           and dirty pages every refs references,\n"
+             "\t           and detect the changes of phase (4)\n"
+             "\t-M file[,bins[,rows]]: write the faults of bins\n"
+             "\t           ranges of pages (256) to file, as CSV,\n"
+             "\t           or as PGM (.pgm) with a row for every\n"
+             "\t           rows references (10000)\n"
+             "\t-f trace: replay a trace file (text or binary, see\n"
+             "\t           gen_trace -b) instead of running gen_trace\n"
+             "\t-s seed: seed of the random initial order and\n"
+             "\t           pivots (0)\n"
+             "\t-r seed: seed of the random replacement (0)\n"
+             "\t-B: translate the references in batches, faster,\n"
+             "\t           but the pages present are handled\n"
+             "\t           without sim_mmu (use it once sim_mmu\n"
+             "\t           works)\n"
+             "\n");
+
     fprintf (stderr,
              "    EXAMPLES:\n"
              "\t%s 16 32 MER RAN 1000\n"
              "\t%s 1 3 HEA DES 4 D\n"
+             "\t%s -H 8 -p 4 16 64 QUI RAN 10000\n"
+             "\t%s -D ssd:8 -L 80 16 64 QUI RAN 10000\n"
              "\n",
-             argv[0], argv[0]);
+             name, name, name, name);
 
     return -1;
 }
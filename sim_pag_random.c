@@ -8,6 +8,7 @@
 #include <string.h>
 
 #include "./sim_paging.h"
+#include "./sim_stats.h"
 
 // Function that initialises the tables
 
@@ -15,7 +16,7 @@ void init_tables(ssystem* S) {
   int i;
 
   // Reset pages
-  memset(S->pgt, 0, sizeof(spage) * S->numpags);
+  clear_page_table(S);
 
   // Empty LRU stack
   S->lru = -1;
@@ -54,7 +55,7 @@ void reference_page(ssystem* S, int page, char op) {
   if (op == 'R') {              // If it's a read,
     S->numrefsread++;           // count it
   } else if (op == 'W') {       // If it's a write,
-    S->pgt[page].modified = 1;  // count it and mark the
+    PGT_SET_MODIFIED(S, page, 1);  // count it and mark the
     S->numrefswrite++;          // page 'modified'
   }
 }
@@ -64,32 +65,30 @@ void reference_page(ssystem* S, int page, char op) {
 void handle_page_fault(ssystem* S, unsigned virtual_addr) {
   int page, victim, frame, last;
 
+  STATS_HANDLER();
+
   // TODO(student):
   //       Type in the code that simulates the Operating
   //       System's response to a page fault trap
 }
 
-static unsigned myrandom(unsigned from,  // <<--- random
+static unsigned myrandom(ssystem* S,     // <<--- random
+                         unsigned from,
                          unsigned size) {
-  unsigned n;
-
-  n = from + (unsigned)(rand() / (RAND_MAX + 1.0) * size);
-
-  if (n > from + size - 1)  // These checks shouldn't
-    n = from + size - 1;    // be necessary, but it's
-  else if (n < from)        // better to not rely too
-    n = from;               // much on the floating
-                            // point operations
-  return n;
+  // Each system has its own generator, started with the seed
+  // of the policy (option -r), so that the runs can be repeated
+  return from + xoshiro_below(&S->random, size);
 }
 
 int choose_page_to_be_replaced(ssystem* S) {
   int frame, victim;
 
-  frame = myrandom(0, S->numframes);  // <<--- random
+  frame = myrandom(S, 0, S->numframes);  // <<--- random
 
   victim = S->frt[frame].page;
 
+  STATS_SCAN(1);  // No scan: the victim is found at once
+
   if (S->detailed)
     printf(
         "@ Choosing (at random) P%d of F%d to be "
@@ -102,9 +101,9 @@ int choose_page_to_be_replaced(ssystem* S) {
 void replace_page(ssystem* S, int victim, int newpage) {
   int frame;
 
-  frame = S->pgt[victim].frame;
+  frame = PGT_FRAME(S, victim);
 
-  if (S->pgt[victim].modified) {
+  if (PGT_MODIFIED(S, victim)) {
     if (S->detailed)
       printf(
           "@ Writing modified P%d back (to disc) to "
@@ -117,18 +116,22 @@ void replace_page(ssystem* S, int victim, int newpage) {
   if (S->detailed)
     printf("@ Replacing victim P%d with P%d in F%d\n", victim, newpage, frame);
 
-  S->pgt[victim].present = 0;
+  PGT_SET_PRESENT(S, victim, 0);
 
-  S->pgt[newpage].present = 1;
-  S->pgt[newpage].frame = frame;
-  S->pgt[newpage].modified = 0;
+  PGT_SET_PRESENT(S, newpage, 1);
+  PGT_FRAME(S, newpage) = frame;
+  PGT_SET_MODIFIED(S, newpage, 0);
 
   S->frt[frame].page = newpage;
+
+  STATS_REPLACE(S, newpage, frame, victim);
 }
 
 void occupy_free_frame(ssystem* S, int frame, int page) {
   if (S->detailed) printf("@ Storing P%d in F%d\n", page, frame);
 
+  STATS_FREE_FRAME(S, page, frame);
+
   // TODO(student):
   //       Write the code that links the page with the frame and
   //       vice-versa, and wites the corresponding values in the
@@ -143,11 +146,11 @@ void print_page_table(ssystem* S) {
   printf("%10s %10s %10s   %s\n", "PAGE", "Present", "Frame", "Modified");
 
   for (p = 0; p < S->numpags; p++)
-    if (S->pgt[p].present)
-      printf("%8d   %6d     %8d   %6d\n", p, S->pgt[p].present, S->pgt[p].frame,
-             S->pgt[p].modified);
+    if (PGT_PRESENT(S, p))
+      printf("%8d   %6d     %8d   %6d\n", p, PGT_PRESENT(S, p),
+             PGT_FRAME(S, p), PGT_MODIFIED(S, p));
     else
-      printf("%8d   %6d     %8s   %6s\n", p, S->pgt[p].present, "-", "-");
+      printf("%8d   %6d     %8s   %6s\n", p, PGT_PRESENT(S, p), "-", "-");
 }
 
 void print_frames_table(ssystem* S) {
@@ -160,11 +163,11 @@ void print_frames_table(ssystem* S) {
 
     if (p == -1)
       printf("%8d   %8s   %6s     %6s\n", f, "-", "-", "-");
-    else if (S->pgt[p].present)
-      printf("%8d   %8d   %6d     %6d\n", f, p, S->pgt[p].present,
-             S->pgt[p].modified);
+    else if (PGT_PRESENT(S, p))
+      printf("%8d   %8d   %6d     %6d\n", f, p, PGT_PRESENT(S, p),
+             PGT_MODIFIED(S, p));
     else
-      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, S->pgt[p].present,
+      printf("%8d   %8d   %6d     %6s   ERROR!\n", f, p, PGT_PRESENT(S, p),
              "-");
   }
 }
@@ -5,6 +5,8 @@
 #ifndef _SIM_PAGING_H_
 #define _SIM_PAGING_H_
 
+#include "xoshiro.h"
+
 // Structure that holds the state of a page,
 // sumulating an entry of the page table
 
@@ -27,6 +29,71 @@ typedef struct
 }
 spage;
 
+// The page table can also be kept as a structure of arrays,
+// compiling with -DSIM_PAGING_SOA: the bits of all the pages
+// are packed in bitmaps, and the frames and time marks are in
+// arrays of their own. Checking whether a page is present then
+// only touches one bit, and scans over the table only read the
+// field they need.
+
+#define PGT_WORD(p)   ((p)>>5)
+#define PGT_MASK(p)   (1U<<((p)&31))
+
+#define PGT_GET_BIT(B,p)  (((B)[PGT_WORD(p)] & PGT_MASK(p)) != 0)
+#define PGT_SET_BIT(B,p,v) \
+    ((v) ? ((B)[PGT_WORD(p)] |= PGT_MASK(p)) \
+         : ((B)[PGT_WORD(p)] &= ~PGT_MASK(p)))
+
+#ifdef SIM_PAGING_SOA
+
+typedef struct
+{
+    unsigned * present;     // Bitmaps, 1 bit per page
+    unsigned * modified;
+    unsigned * referenced;
+    int * frame;
+    unsigned * timestamp;
+}
+spagetable;
+
+#define PGT_PRESENT(S,p)           PGT_GET_BIT((S)->pgt.present,p)
+#define PGT_MODIFIED(S,p)          PGT_GET_BIT((S)->pgt.modified,p)
+#define PGT_REFERENCED(S,p)        PGT_GET_BIT((S)->pgt.referenced,p)
+#define PGT_SET_PRESENT(S,p,v)     PGT_SET_BIT((S)->pgt.present,p,v)
+#define PGT_SET_MODIFIED(S,p,v)    PGT_SET_BIT((S)->pgt.modified,p,v)
+#define PGT_SET_REFERENCED(S,p,v)  PGT_SET_BIT((S)->pgt.referenced,p,v)
+#define PGT_FRAME(S,p)             ((S)->pgt.frame[p])
+#define PGT_TIMESTAMP(S,p)         ((S)->pgt.timestamp[p])
+#define PGT_PRESENT_BITMAP(S)      ((S)->pgt.present)
+
+#else
+
+// As an array of spage, the present bits are also copied to a
+// bitmap by PGT_SET_PRESENT, for sim_mmu_batch
+
+typedef spage * spagetable;
+
+#define PGT_PRESENT(S,p)           ((S)->pgt[p].present)
+#define PGT_MODIFIED(S,p)          ((S)->pgt[p].modified)
+#define PGT_REFERENCED(S,p)        ((S)->pgt[p].referenced)
+#define PGT_SET_PRESENT(S,p,v)     ((S)->pgt[p].present = (v), \
+                                    PGT_SET_BIT((S)->presbits,p, \
+                                                (S)->pgt[p].present))
+#define PGT_SET_MODIFIED(S,p,v)    ((S)->pgt[p].modified = (v))
+#define PGT_SET_REFERENCED(S,p,v)  ((S)->pgt[p].referenced = (v))
+#define PGT_FRAME(S,p)             ((S)->pgt[p].frame)
+#define PGT_TIMESTAMP(S,p)         ((S)->pgt[p].timestamp)
+#define PGT_PRESENT_BITMAP(S)      ((S)->presbits)
+
+#endif
+
+// The code that must build with both layouts accesses the page
+// table through the macros above (the page may be evaluated
+// more than once); PGT_FRAME and PGT_TIMESTAMP can be assigned.
+// PGT_PRESENT_BITMAP is the bitmap of the pages present, in
+// both layouts, as long as the present bits are only changed
+// with PGT_SET_PRESENT and clear_page_table.
+
 // Structure that holds the state of a frame
 // (the hardware doesn't know anything about this struct)
 
@@ -46,9 +113,13 @@ typedef struct
     // Page table (maintained by HW and OS)
     int pagsz;
     int numpags;
-    spage * pgt;
+    spagetable pgt;
+#ifndef SIM_PAGING_SOA
+    unsigned * presbits;   // Copy of the present bits
+#endif
     int lru;               // Only for LRU replacement
     unsigned clock;        // Only for LRU(t) replacement
+    sxoshiro random;       // Only for random replacement
 
     // Frames table (maintained by the OS only)
     int numframes;
@@ -66,6 +137,14 @@ typedef struct
 }
 ssystem;
 
+// Functions that create, clear and destroy the page table of
+// S->numpags pages, in any layout. alloc_page_table returns -1
+// if there is not enough memory.
+
+int alloc_page_table (ssystem * S);
+void clear_page_table (ssystem * S);
+void free_page_table (ssystem * S);
+
 // Function that initialises the tables
 
 void init_tables (ssystem * S);
@@ -75,6 +154,16 @@ void init_tables (ssystem * S);
 unsigned sim_mmu (ssystem * S, unsigned virt_address, char op);
 void reference_page (ssystem * S, int page, char op);
 
+// Translate n addresses at once: the same as sim_mmu for each
+// one, but faster when the pages are present, as only the
+// faults go through sim_mmu. The presence is taken from
+// PGT_PRESENT_BITMAP. The physical addresses are stored in
+// 'physaddrs', unless it's NULL.
+
+void sim_mmu_batch (ssystem * S, const unsigned addrs[],
+                    const char ops[], unsigned n,
+                    unsigned physaddrs[]);
+
 // Functions that simulate the operating system
 
 void handle_page_fault (ssystem * S, unsigned virt_address);
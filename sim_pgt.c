@@ -0,0 +1,91 @@
+/*
+    sim_pgt.c
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim_paging.h"
+
+// Words of a bitmap of n pages
+
+static size_t bitmap_bytes (int n)
+{
+    return ((size_t)n+31)/32 * sizeof(unsigned);
+}
+
+#ifdef SIM_PAGING_SOA
+
+int alloc_page_table (ssystem * S)
+{
+    size_t n = S->numpags;
+
+    S->pgt.present = (unsigned*) malloc (bitmap_bytes(n));
+    S->pgt.modified = (unsigned*) malloc (bitmap_bytes(n));
+    S->pgt.referenced = (unsigned*) malloc (bitmap_bytes(n));
+    S->pgt.frame = (int*) malloc (n*sizeof(int));
+    S->pgt.timestamp = (unsigned*) malloc (n*sizeof(unsigned));
+
+    if (!S->pgt.present || !S->pgt.modified ||
+        !S->pgt.referenced || !S->pgt.frame || !S->pgt.timestamp)
+    {
+        free_page_table (S);
+        return -1;
+    }
+
+    return 0;
+}
+
+void clear_page_table (ssystem * S)
+{
+    size_t n = S->numpags;
+
+    memset (S->pgt.present, 0, bitmap_bytes(n));
+    memset (S->pgt.modified, 0, bitmap_bytes(n));
+    memset (S->pgt.referenced, 0, bitmap_bytes(n));
+    memset (S->pgt.frame, 0, n*sizeof(int));
+    memset (S->pgt.timestamp, 0, n*sizeof(unsigned));
+}
+
+void free_page_table (ssystem * S)
+{
+    free (S->pgt.present);
+    free (S->pgt.modified);
+    free (S->pgt.referenced);
+    free (S->pgt.frame);
+    free (S->pgt.timestamp);
+
+    memset (&S->pgt, 0, sizeof(S->pgt));
+}
+
+#else
+
+int alloc_page_table (ssystem * S)
+{
+    S->pgt = (spage*) malloc ((size_t)S->numpags*sizeof(spage));
+    S->presbits = (unsigned*) malloc (bitmap_bytes(S->numpags));
+
+    if (!S->pgt || !S->presbits)
+    {
+        free_page_table (S);
+        return -1;
+    }
+
+    return 0;
+}
+
+void clear_page_table (ssystem * S)
+{
+    memset (S->pgt, 0, (size_t)S->numpags*sizeof(spage));
+    memset (S->presbits, 0, bitmap_bytes(S->numpags));
+}
+
+void free_page_table (ssystem * S)
+{
+    free (S->pgt);
+    free (S->presbits);
+    S->pgt = NULL;
+    S->presbits = NULL;
+}
+
+#endif
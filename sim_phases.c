@@ -0,0 +1,158 @@
+/*
+    sim_phases.c
+*/
+
+#include <stdio.h>
+
+#include "sim_phases.h"
+
+// Dirty pages in memory (those that would have to be written
+// back if replaced)
+
+static int dirty_pages (ssystem * S)
+{
+    int f, p, n = 0;
+
+    for (f=0; f<S->numframes; f++)
+    {
+        p = S->frt[f].page;
+
+        if (p>=0 && p<S->numpags && PGT_PRESENT(S,p) &&
+            PGT_MODIFIED(S,p))
+            n ++;
+    }
+
+    return n;
+}
+
+// Start a phase at the given reference, with the intervals
+// seen since then
+
+static void new_phase (sphases * I, unsigned long long start,
+                       unsigned seglen, double segsum)
+{
+    I->phase ++;
+    I->start = start;
+    I->seglen = seglen;
+    I->segsum = segsum;
+    I->up = I->minup = I->down = I->maxdown = 0;
+    I->upstart = I->downstart = I->numrefs;
+    I->uplen = I->downlen = 0;
+    I->upsum = I->downsum = 0;
+}
+
+// Summary of a phase
+
+static void print_phase (int phase, unsigned long long start,
+                         unsigned long long end, unsigned seglen,
+                         double segsum)
+{
+    printf ("# Phase %d: references %llu-%llu, %u intervals, "
+            "mean fault rate %.4f\n", phase, start, end-1,
+            seglen, segsum/seglen);
+}
+
+void phases_init (sphases * I, unsigned interval, double lambda,
+                  ssystem * S)
+{
+    I->interval = interval;
+    I->delta = PHASES_DELTA;
+    I->lambda = lambda;
+    I->numrefs = 0;
+    I->faults = S->numpagefaults;
+    I->writebacks = S->numpgwriteback;
+    I->phase = 0;
+    I->seglen = 0;
+
+    printf ("# Intervals of %u references, phases detected with "
+            "lambda %g\n", interval, lambda);
+    printf ("#%11s %8s %8s %8s %8s %6s\n", "Refs", "Faults",
+            "WBacks", "Dirty", "Rate", "Phase");
+}
+
+// The phase changed at reference 'start': the last 'seglen'
+// intervals, with a sum of rates 'segsum', belong to the next
+
+static void change (sphases * I, const char * direction,
+                    unsigned long long start, unsigned seglen,
+                    double segsum)
+{
+    print_phase (I->phase, I->start, start, I->seglen-seglen,
+                 I->segsum-segsum);
+    printf ("# Change of phase: fault rate %s since reference "
+            "%llu\n", direction, start);
+
+    new_phase (I, start, seglen, segsum);
+}
+
+void phases_interval (sphases * I, ssystem * S, unsigned numrefs)
+{
+    int faults = S->numpagefaults - I->faults;
+    int writebacks = S->numpgwriteback - I->writebacks;
+    double rate = (double) faults / numrefs, mean, scale;
+    unsigned long long first = I->numrefs;
+
+    I->numrefs += numrefs;
+    I->faults = S->numpagefaults;
+    I->writebacks = S->numpgwriteback;
+
+    if (!I->phase)
+        new_phase (I, first, 1, rate);
+    else if (I->seglen < PHASES_MINLEN)
+    {
+        I->seglen ++;
+        I->segsum += rate;
+    }
+    else
+    {
+        mean = I->segsum / I->seglen;
+        scale = mean > 1.0/I->interval ? mean : 1.0/I->interval;
+
+        // Accumulate the deviations, and keep the intervals
+        // since the extreme of each sum: if a change is
+        // detected, it began there
+        I->up += rate - mean - I->delta*scale;
+        I->down += rate - mean + I->delta*scale;
+        I->uplen ++;
+        I->upsum += rate;
+        I->downlen ++;
+        I->downsum += rate;
+
+        if (I->up < I->minup)
+        {
+            I->minup = I->up;
+            I->upstart = I->numrefs;
+            I->uplen = 0;
+            I->upsum = 0;
+        }
+
+        if (I->down > I->maxdown)
+        {
+            I->maxdown = I->down;
+            I->downstart = I->numrefs;
+            I->downlen = 0;
+            I->downsum = 0;
+        }
+
+        I->seglen ++;
+        I->segsum += rate;
+
+        if (I->up - I->minup > I->lambda*scale)
+            change (I, "up", I->upstart, I->uplen, I->upsum);
+        else if (I->maxdown - I->down > I->lambda*scale)
+            change (I, "down", I->downstart, I->downlen,
+                    I->downsum);
+    }
+
+    printf ("%12llu %8d %8d %8d %8.4f %6d\n", I->numrefs, faults,
+            writebacks, dirty_pages(S), rate, I->phase);
+}
+
+void phases_end (sphases * I)
+{
+    if (I->phase)
+        print_phase (I->phase, I->start, I->numrefs, I->seglen,
+                     I->segsum);
+
+    printf ("\n");
+}
@@ -0,0 +1,61 @@
+/*
+    sim_phases.h
+*/
+
+#ifndef _SIM_PHASES_H_
+#define _SIM_PHASES_H_
+
+#include "sim_paging.h"
+
+// Interval mode: every 'interval' references, a line with the
+// page faults and write-backs of the interval, the dirty pages
+// that are resident at its end, and the fault rate. The
+// phases of the program are detected on the fly, as changes of
+// the fault rate, with a two-sided Page-Hinkley test: the
+// deviations of the rate from the mean of the current phase are
+// accumulated, ignoring those smaller than 'delta' times the
+// mean, and a change is detected when the accumulated deviation
+// (up or down) exceeds 'lambda' times the mean. The mean is
+// taken as one fault per interval at least, so that phases
+// without faults do not make any fault a change.
+
+#define PHASES_DELTA    0.25   // Defaults
+#define PHASES_LAMBDA   4.0
+#define PHASES_MINLEN   3      // Intervals to learn the mean
+
+typedef struct
+{
+    unsigned interval;            // References per interval
+    double delta, lambda;         // Parameters of the test
+    unsigned long long numrefs;   // References so far
+    int faults, writebacks;       // At the start of the interval
+
+    int phase;                    // Current phase (from 1)
+    unsigned long long start;     //  ... first reference
+    unsigned seglen;              // Intervals in the phase
+    double segsum;                //  ... sum of their rates
+    double up, minup;             // Page-Hinkley sums (increase)
+    double down, maxdown;         //  ... (decrease)
+    unsigned long long upstart;   // Where the change would have
+    unsigned long long downstart; //  ... begun, in each case
+    unsigned uplen, downlen;      // Intervals since then
+    double upsum, downsum;        //  ... sum of their rates
+}
+sphases;
+
+// Print the header. The simulator must be ready to start.
+
+void phases_init (sphases * I, unsigned interval, double lambda,
+                  ssystem * S);
+
+// Print the line of an interval of 'numrefs' references, that
+// have just been simulated (less than 'interval' only for the
+// last one), and test whether a new phase has begun
+
+void phases_interval (sphases * I, ssystem * S, unsigned numrefs);
+
+// Print a summary of the phases
+
+void phases_end (sphases * I);
+
+#endif // _SIM_PHASES_H_
@@ -0,0 +1,216 @@
+/*
+    sim_stats.c
+*/
+
+#include "sim_stats.h"
+
+#ifdef SIM_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+sstats sim_stats;
+
+static volatile sig_atomic_t requested;   // SIGUSR1 received
+static unsigned long long startticks;     // For calibrating
+static double startns;                    //  ... the ticks
+
+static const char * phasenames[STATS_PHASES] =
+    { "setup", "trace", "mmu", "fault", "report" };
+
+static double now_ns (void)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+
+    return t.tv_sec*1e9 + t.tv_nsec;
+}
+
+// The time stamp counter where there is one (a few cycles),
+// nanoseconds otherwise
+
+static unsigned long long ticks (void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#else
+    return now_ns ();
+#endif
+}
+
+// Only take note: the output is written from stats_poll, out
+// of the signal handler
+
+static void on_signal (int sig)
+{
+    requested = 1;
+}
+
+void stats_init (ssystem * S)
+{
+    const char * sample = getenv ("SIM_STATS_SAMPLE");
+
+    memset (&sim_stats, 0, sizeof(sim_stats));
+
+    sim_stats.S = S;
+    sim_stats.sample = sample ? atoi (sample) : 1;
+
+    if (sim_stats.sample<1)
+        sim_stats.sample = 1;
+
+    startticks = sim_stats.since = ticks ();
+    startns = now_ns ();
+    sim_stats.phase = STATS_SETUP;
+
+    signal (SIGUSR1, on_signal);
+}
+
+void stats_enter (int phase)
+{
+    unsigned long long t = ticks ();
+
+    sim_stats.ticks[sim_stats.phase] += t - sim_stats.since;
+    sim_stats.since = t;
+    sim_stats.phase = phase;
+}
+
+void stats_scan (unsigned long long length)
+{
+    int bin;
+
+    for (bin=0; bin<STATS_BINS-1 && (2ULL<<bin)<=length; bin++)
+        ;
+
+    sim_stats.numscans ++;
+    sim_stats.sumscans += length;
+    sim_stats.scanbins[bin] ++;
+
+    if (length > sim_stats.maxscan)
+        sim_stats.maxscan = length;
+}
+
+void stats_fault (ssystem * S, int page, int frame, int victim)
+{
+    sstatsfault * F;
+
+    if (sim_stats.numfaults++ % sim_stats.sample)
+        return;
+
+    F = &sim_stats.ring[sim_stats.numsampled++ % STATS_RING];
+    F->ref = (unsigned long long) S->numrefsread + S->numrefswrite;
+    F->page = page;
+    F->frame = frame;
+    F->victim = victim;
+}
+
+void stats_poll (void)
+{
+    if (requested)
+    {
+        requested = 0;
+        stats_dump ();
+    }
+}
+
+void stats_dump (void)
+{
+    const char * path = getenv ("SIM_STATS_FILE");
+    ssystem * S = sim_stats.S;
+    double nspertick;
+    unsigned long long n, i, last;
+    FILE * pf;
+    int p, b;
+
+    // Bring the current phase up to date
+    stats_enter (sim_stats.phase);
+
+    nspertick = sim_stats.since > startticks ?
+                (now_ns()-startns) / (sim_stats.since-startticks) : 0;
+
+    pf = path ? fopen (path, "w") : stderr;
+
+    if (!pf)
+    {
+        perror ("ERROR writing the statistics");
+        return;
+    }
+
+    fprintf (pf, "{\n");
+    fprintf (pf, "  \"references\": %llu,\n",
+             (unsigned long long) S->numrefsread + S->numrefswrite);
+    fprintf (pf, "  \"reads\": %d,\n", S->numrefsread);
+    fprintf (pf, "  \"writes\": %d,\n", S->numrefswrite);
+    fprintf (pf, "  \"page_faults\": %d,\n", S->numpagefaults);
+    fprintf (pf, "  \"write_backs\": %d,\n", S->numpgwriteback);
+    fprintf (pf, "  \"illegal_references\": %d,\n",
+             S->numillegalrefs);
+    fprintf (pf, "  \"fault_handler_calls\": %llu,\n",
+             sim_stats.handlercalls);
+    fprintf (pf, "  \"free_frame_hits\": %llu,\n",
+             sim_stats.freeframes);
+    fprintf (pf, "  \"replacements\": %llu,\n",
+             sim_stats.replacements);
+
+    fprintf (pf, "  \"victim_scans\": {\n");
+    fprintf (pf, "    \"count\": %llu,\n", sim_stats.numscans);
+    fprintf (pf, "    \"total\": %llu,\n", sim_stats.sumscans);
+    fprintf (pf, "    \"mean\": %.3f,\n", sim_stats.numscans ?
+             (double) sim_stats.sumscans / sim_stats.numscans : 0);
+    fprintf (pf, "    \"max\": %llu,\n", sim_stats.maxscan);
+
+    // Bin b holds the lengths from 2^b to 2^(b+1)-1
+    for (last=0, b=0; b<STATS_BINS; b++)
+        if (sim_stats.scanbins[b])
+            last = b+1;
+
+    fprintf (pf, "    \"log2_histogram\": [");
+
+    for (b=0; b<last; b++)
+        fprintf (pf, "%s%llu", b ? ", " : "", sim_stats.scanbins[b]);
+
+    fprintf (pf, "]\n  },\n");
+
+    fprintf (pf, "  \"phases_ns\": {");
+
+    for (p=0; p<STATS_PHASES; p++)
+        fprintf (pf, "%s\n    \"%s\": %.0f", p ? "," : "",
+                 phasenames[p], sim_stats.ticks[p] * nspertick);
+
+    fprintf (pf, "\n  },\n");
+
+    // The oldest fault in the ring first
+    n = sim_stats.numsampled < STATS_RING ? sim_stats.numsampled
+                                          : STATS_RING;
+
+    fprintf (pf, "  \"faults_seen\": %llu,\n", sim_stats.numfaults);
+    fprintf (pf, "  \"fault_sample_period\": %u,\n",
+             sim_stats.sample);
+    fprintf (pf, "  \"recent_faults\": [");
+
+    for (i=sim_stats.numsampled-n; i<sim_stats.numsampled; i++)
+    {
+        sstatsfault * F = &sim_stats.ring[i % STATS_RING];
+
+        fprintf (pf, "%s\n    {\"ref\": %llu, \"page\": %d, "
+                     "\"frame\": %d, \"victim\": %d}",
+                 i>sim_stats.numsampled-n ? "," : "",
+                 F->ref, F->page, F->frame, F->victim);
+    }
+
+    fprintf (pf, "%s]\n}\n", n ? "\n  " : "");
+
+    if (pf==stderr)
+        fflush (pf);
+    else
+        fclose (pf);
+}
+
+#endif
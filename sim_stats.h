@@ -0,0 +1,113 @@
+/*
+    sim_stats.h
+*/
+
+#ifndef _SIM_STATS_H_
+#define _SIM_STATS_H_
+
+#include "sim_paging.h"
+
+// Instrumentation of the simulators, compiled in only with
+// -DSIM_STATS (make SIM_FLAGS=-DSIM_STATS). Otherwise all the
+// macros below are empty, and cost nothing.
+//
+// It counts the calls to the page fault handler, the faults
+// served with a free frame and by replacement, and the number
+// of entries examined to choose each victim; measures the time
+// spent in each phase of the simulation; and keeps the last
+// STATS_RING faults (or one out of every SIM_STATS_SAMPLE
+// faults, if that environment variable is set) in a ring
+// buffer. Everything is written in JSON at the end, and also
+// whenever the process receives SIGUSR1, to the file given by
+// the environment variable SIM_STATS_FILE or else to stderr.
+
+// Phases of the simulation
+
+#define STATS_SETUP   0   // Creating the tables
+#define STATS_TRACE   1   // Reading and parsing the trace
+#define STATS_MMU     2   // Simulating the references
+#define STATS_FAULT   3   //  ... that miss (batch MMU only)
+#define STATS_REPORT  4   // Printing the results
+
+#define STATS_PHASES  5
+
+#ifdef SIM_STATS
+
+#define STATS_RING     1024  // Faults kept
+#define STATS_BINS     32    // Bins of the scan lengths (log2)
+
+// A fault: reference where it happened, page loaded, frame,
+// and page replaced (-1 if the frame was free)
+
+typedef struct
+{
+    unsigned long long ref;
+    int page, frame, victim;
+}
+sstatsfault;
+
+typedef struct
+{
+    ssystem * S;                      // System simulated
+    unsigned long long handlercalls;  // Calls to the handler
+    unsigned long long freeframes;    // Faults with a free frame
+    unsigned long long replacements;  // Faults with replacement
+
+    unsigned long long numscans;      // Victims chosen
+    unsigned long long sumscans;      // Entries examined
+    unsigned long long maxscan;       //  ... max. at once
+    unsigned long long scanbins[STATS_BINS]; // Histogram
+
+    int phase;                        // Current phase
+    unsigned long long since;         //  ... since this tick
+    unsigned long long ticks[STATS_PHASES]; // Per phase
+
+    sstatsfault ring[STATS_RING];     // Last faults sampled
+    unsigned long long numfaults;     // Faults seen
+    unsigned long long numsampled;    // Faults in the ring
+    unsigned sample;                  // Sampling period
+}
+sstats;
+
+extern sstats sim_stats;
+
+void stats_init (ssystem * S);
+void stats_enter (int phase);
+void stats_scan (unsigned long long length);
+void stats_fault (ssystem * S, int page, int frame, int victim);
+void stats_poll (void);
+void stats_dump (void);
+
+#define STATS_INIT(S)           stats_init (S)
+#define STATS_ENTER(P)          stats_enter (P)
+#define STATS_HANDLER()         (sim_stats.handlercalls ++)
+#define STATS_SCAN(N)           stats_scan (N)
+#define STATS_FREE_FRAME(S,P,F) (sim_stats.freeframes ++, \
+                                 stats_fault (S, P, F, -1))
+#define STATS_REPLACE(S,P,F,V)  (sim_stats.replacements ++, \
+                                 stats_fault (S, P, F, V))
+#define STATS_POLL()            stats_poll ()
+#define STATS_DUMP()            stats_dump ()
+
+#else
+
+#define STATS_INIT(S)           ((void) 0)
+#define STATS_ENTER(P)          ((void) 0)
+#define STATS_HANDLER()         ((void) 0)
+#define STATS_SCAN(N)           ((void) 0)
+#define STATS_FREE_FRAME(S,P,F) ((void) 0)
+#define STATS_REPLACE(S,P,F,V)  ((void) 0)
+#define STATS_POLL()            ((void) 0)
+#define STATS_DUMP()            ((void) 0)
+
+#endif
+
+// Where they go:
+//
+//   STATS_HANDLER     at the start of handle_page_fault
+//   STATS_SCAN        in choose_page_to_be_replaced, with the
+//                     number of pages or frames examined
+//   STATS_FREE_FRAME  in occupy_free_frame
+//   STATS_REPLACE     in replace_page
+
+#endif // _SIM_STATS_H_
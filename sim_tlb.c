@@ -0,0 +1,79 @@
+/*
+    sim_tlb.c
+*/
+
+#include <stdlib.h>
+
+#include "sim_tlb.h"
+
+int tlb_init (stlb * T, int numentries)
+{
+    T->numentries = numentries;
+    T->numvalid = 0;
+    T->clock = 0;
+    T->numhits = T->nummisses = 0;
+    T->tag = (unsigned*) malloc (numentries*sizeof(unsigned));
+    T->stamp = (unsigned*) malloc (numentries*sizeof(unsigned));
+
+    if (T->tag && T->stamp)
+        return 0;
+
+    tlb_free (T);
+    return -1;
+}
+
+void tlb_free (stlb * T)
+{
+    free (T->tag);
+    free (T->stamp);
+    T->tag = NULL;
+    T->stamp = NULL;
+}
+
+int tlb_lookup (stlb * T, unsigned tag)
+{
+    int e, lru;
+
+    T->clock ++;
+
+    // Entries 0..numvalid-1 are in use: search the tag and,
+    // at the same time, the least recently used entry
+
+    for (e=lru=0; e<T->numvalid; e++)
+    {
+        if (T->tag[e]==tag)
+        {
+            T->stamp[e] = T->clock;
+            T->numhits ++;
+            return 1;
+        }
+
+        if (T->stamp[e] < T->stamp[lru])
+            lru = e;
+    }
+
+    T->nummisses ++;
+
+    if (T->numvalid < T->numentries)   // Free entry
+        lru = T->numvalid++;
+
+    T->tag[lru] = tag;
+    T->stamp[lru] = T->clock;
+
+    return 0;
+}
+
+void tlb_invalidate (stlb * T, unsigned tag)
+{
+    int e;
+
+    for (e=0; e<T->numvalid; e++)
+        if (T->tag[e]==tag)
+        {
+            // Keep the valid entries packed at the beginning
+            T->numvalid --;
+            T->tag[e] = T->tag[T->numvalid];
+            T->stamp[e] = T->stamp[T->numvalid];
+            return;
+        }
+}
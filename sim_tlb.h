@@ -0,0 +1,39 @@
+/*
+    sim_tlb.h
+*/
+
+#ifndef _SIM_TLB_H_
+#define _SIM_TLB_H_
+
+// Fully associative TLB with LRU replacement. Each entry
+// caches the translation of one page (of whatever size the
+// TLB is used for), identified by its page number or "tag"
+
+typedef struct
+{
+    int numentries;     // Capacity of the TLB
+    int numvalid;       // Entries currently in use
+    unsigned * tag;     // Page number cached in each entry
+    unsigned * stamp;   // Time mark of the last use (LRU)
+    unsigned clock;     // Time, incremented at each lookup
+    unsigned numhits;   // Counter of lookups that hit
+    unsigned nummisses; // Counter of lookups that missed
+}
+stlb;
+
+// Reserve and free the entries (0 = OK, -1 = no memory)
+
+int tlb_init (stlb * T, int numentries);
+void tlb_free (stlb * T);
+
+// Look up a page. Returns 1 on a hit; on a miss the
+// translation is loaded, replacing the LRU entry, and 0 is
+// returned
+
+int tlb_lookup (stlb * T, unsigned tag);
+
+// Invalidate the entry of a page (TLB shootdown), if cached
+
+void tlb_invalidate (stlb * T, unsigned tag);
+
+#endif // _SIM_TLB_H_
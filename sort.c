@@ -3,7 +3,11 @@
 */
 
 #include <stdlib.h>
+#include <math.h>
+#include <assert.h>
 #include "sort.h"
+#include "bitonic.h"
+#include "xoshiro.h"
 
 // Sorting by the bubble method
 //     Stable:                yes
@@ -61,19 +65,37 @@ unsigned bubble_sort (void * p, unsigned size,
 //                            to be faster. It will always be
 //                            O(N*N) worst case, though.
 
+static unsigned insertion_sort_r (void * p,
+                                  unsigned from, unsigned size,
+                                  function_lesser_than * plesserthan,
+                                  function_read * pread,
+                                  function_write * pwrite);
+
 unsigned insertion_sort (void * p, unsigned size,
                          function_lesser_than * plesserthan,
                          function_read * pread,
                          function_write * pwrite)
+{
+    return insertion_sort_r (p, 0, size, plesserthan, pread, pwrite);
+}
+
+// The same, for the elements from..from+size-1 (the radix sorts
+// leave the small buckets to it)
+
+static unsigned insertion_sort_r (void * p,
+                                  unsigned from, unsigned size,
+                                  function_lesser_than * plesserthan,
+                                  function_read * pread,
+                                  function_write * pwrite)
 {
     unsigned u, v, iter;
     thing a, b, c;
 
-    a = pread (p, 0);
+    a = pread (p, from);
 
     for (u=1, iter=0; u<size; u++)
     {
-        b = pread (p, u);
+        b = pread (p, from+u);
 
         if (plesserthan(p,b,a))
         {
@@ -82,17 +104,17 @@ unsigned insertion_sort (void * p, unsigned size,
 
             do
             {
-                pwrite (p, v, c);
+                pwrite (p, from+v, c);
                 iter ++;
 
                 if (--v==0)
                     break;
 
-                c = pread (p, v-1);
+                c = pread (p, from+v-1);
             }
             while (plesserthan(p,b,c));
 
-            pwrite (p, v, b);
+            pwrite (p, from+v, b);
         }
         else
         {
@@ -252,6 +274,308 @@ static unsigned sift_in (void * p, unsigned size,
     return iter;
 }
 
+// Sorting by the heap method, with d children per node instead
+// of 2 (d-ary heap)
+//     Stable:                no
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  The heap is log2(d) times shallower,
+//                            but each level needs d-1 comparisons
+//                            to find the largest child. Those
+//                            children are contiguous, so they
+//                            are usually in the same page, and
+//                            going down the heap touches fewer
+//                            pages. As in heap_sort, an element
+//                            is sifted down to a leaf through the
+//                            largest children first, and then up
+//                            to its place, which is usually near
+//                            the bottom (Floyd).
+
+static unsigned sift_in_dary (void * p, unsigned size, unsigned d,
+                              unsigned hole, thing nuevo,
+                              function_lesser_than * plesserthan,
+                              function_read * pread,
+                              function_write * pwrite)
+{
+    unsigned u, c, h, max, iter;
+    thing a, b;
+
+    // Down to a leaf (positions from 0: the children of h are
+    // d*h+1 to d*h+d)
+    for (h=hole, iter=0; (c=d*h+1) < size; h=max, iter++)
+    {
+        a = pread (p, c);
+
+        for (max=c, u=c+1; u<c+d && u<size; u++)
+        {
+            b = pread (p, u);
+
+            if (plesserthan(p,a,b))
+            {
+                a = b;
+                max = u;
+            }
+        }
+
+        pwrite (p, h, a);
+    }
+
+    // Up to the place of the new one
+    while (h>hole)
+    {
+        u = (h-1) / d;
+        a = pread (p, u);
+        iter ++;
+
+        if (!plesserthan(p,a,nuevo))
+            break;
+
+        pwrite (p, h, a);
+        h = u;
+    }
+
+    pwrite (p, h, nuevo);
+
+    return iter;
+}
+
+static unsigned heap_sort_dary (void * p, unsigned size, unsigned d,
+                                function_lesser_than * plesserthan,
+                                function_read * pread,
+                                function_write * pwrite)
+{
+    unsigned pos, iter;
+    thing a;
+
+    if (size<2)
+        return 0;
+
+    // First: heap up, from the last one with children
+
+    for (pos=(size-2)/d+1, iter=0; pos--; )
+        iter += sift_in_dary (p, size, d, pos, pread(p,pos),
+                              plesserthan, pread, pwrite);
+
+    // Second: sort while extracting from the heap
+
+    while (size>1)
+    {
+        a = pread (p, size-1);
+        pwrite (p, size-1, pread(p,0));
+        size --;
+        iter += sift_in_dary (p, size, d, 0, a,
+                              plesserthan, pread, pwrite);
+    }
+
+    return iter;
+}
+
+unsigned heap_sort_4 (void * p, unsigned size,
+                      function_lesser_than * plesserthan,
+                      function_read * pread,
+                      function_write * pwrite)
+{
+    return heap_sort_dary (p, size, 4, plesserthan, pread, pwrite);
+}
+
+unsigned heap_sort_8 (void * p, unsigned size,
+                      function_lesser_than * plesserthan,
+                      function_read * pread,
+                      function_write * pwrite)
+{
+    return heap_sort_dary (p, size, 8, plesserthan, pread, pwrite);
+}
+
+// Sorting by the heap method, with the heap in blocks (B-heap)
+//     Stable:                no
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  A binary heap, but laid out so that
+//                            each block of B elements (B a power
+//                            of 2, a page) holds a whole subtree
+//                            of log2(B) levels: going down the
+//                            heap touches a new block only every
+//                            log2(B) levels, instead of at
+//                            almost every level. The subtree of
+//                            a block has B-1 nodes, in positions
+//                            1 to B-1 of the block, as in the
+//                            classic heap (the position 0 is
+//                            unused), and the children of its
+//                            B/2 leaves are the roots of the B
+//                            blocks below it. The blocks are
+//                            filled in order, so the heap is
+//                            always the first nodes, as in the
+//                            classic one. The elements are spread
+//                            over the blocks at the start, and
+//                            packed again at the end.
+
+static unsigned bheap_block = HEAP_BLOCK;
+
+void heap_sort_block (unsigned elements)
+{
+    // Rounded down to a power of 2
+    for (bheap_block=4; bheap_block*2<=elements; bheap_block*=2)
+        ;
+}
+
+// Position of the node n (from 0, in the order of the blocks)
+
+static unsigned bheap_position (unsigned n)
+{
+    return n / (bheap_block-1) * bheap_block + n % (bheap_block-1) + 1;
+}
+
+// Number of the node at the position pos
+
+static unsigned bheap_node (unsigned pos)
+{
+    return pos / bheap_block * (bheap_block-1) + pos % bheap_block - 1;
+}
+
+// Position of the first child of the node at pos (the second one
+// is right after it, or in the next block). Those beyond 2^32
+// are given as ~0, which is never in the heap.
+
+static unsigned bheap_child (unsigned pos, unsigned * second)
+{
+    unsigned i = pos % bheap_block;
+    unsigned long long block = pos / bheap_block;
+
+    if (i < bheap_block/2)          // In the same block
+    {
+        *second = pos + i + 1;
+        return pos + i;
+    }
+
+    // The roots of two of the blocks below
+    block = block*bheap_block + 1 + 2*(i - bheap_block/2);
+
+    if ((block+1)*bheap_block+1 > ~0U)
+        return *second = ~0U;
+
+    *second = (unsigned) (block+1)*bheap_block + 1;
+
+    return (unsigned) block*bheap_block + 1;
+}
+
+static unsigned bheap_parent (unsigned pos)
+{
+    unsigned block = pos / bheap_block, i = pos % bheap_block;
+
+    if (i>1)
+        return pos - i + i/2;
+
+    // A leaf of the block above
+    i = bheap_block/2 + (block-1) % bheap_block / 2;
+
+    return (block-1) / bheap_block * bheap_block + i;
+}
+
+static unsigned sift_in_bheap (void * p, unsigned size,
+                               unsigned hole, thing nuevo,
+                               function_lesser_than * plesserthan,
+                               function_read * pread,
+                               function_write * pwrite)
+{
+    unsigned u, v, h, iter;
+    thing a, b;
+
+    // Down to a leaf (the nodes from size on are not in the
+    // heap)
+    for (h=hole, iter=0; bheap_node(u=bheap_child(h,&v)) < size;
+         h=u, iter++)
+    {
+        a = pread (p, u);
+
+        if (bheap_node(v) < size)
+        {
+            b = pread (p, v);
+
+            if (plesserthan(p,a,b))
+            {
+                a = b;
+                u = v;
+            }
+        }
+
+        pwrite (p, h, a);
+    }
+
+    // Up to the place of the new one
+    while (h!=hole)
+    {
+        u = bheap_parent (h);
+        a = pread (p, u);
+        iter ++;
+
+        if (!plesserthan(p,a,nuevo))
+            break;
+
+        pwrite (p, h, a);
+        h = u;
+    }
+
+    pwrite (p, h, nuevo);
+
+    return iter;
+}
+
+unsigned heap_sort_blocked (void * p, unsigned size,
+                            function_lesser_than * plesserthan,
+                            function_read * pread,
+                            function_write * pwrite)
+{
+    unsigned n, pos, last, iter, total = size;
+    unsigned root = bheap_position (0);
+    thing a;
+
+    if (size<2)
+        return 0;
+
+    // Spread the nodes over the blocks, from the last one (each
+    // one moves forward)
+    for (n=size, iter=size; n--; )
+        pwrite (p, bheap_position(n), pread(p,n));
+
+    // First: heap up
+
+    for (n=size; n--; )
+    {
+        pos = bheap_position (n);
+
+        if (bheap_node(bheap_child(pos,&last)) < size)
+            iter += sift_in_bheap (p, size, pos, pread(p,pos),
+                                   plesserthan, pread, pwrite);
+    }
+
+    // Second: sort while extracting from the heap
+
+    while (size>1)
+    {
+        last = bheap_position (size-1);
+        a = pread (p, last);
+        pwrite (p, last, pread(p,root));
+        size --;
+        iter += sift_in_bheap (p, size, root, a,
+                               plesserthan, pread, pwrite);
+    }
+
+    // Pack them again, from the first one (each one moves back)
+    for (n=0, iter+=total; n<total; n++)
+        pwrite (p, n, pread(p,bheap_position(n)));
+
+    return iter;
+}
+
+// The blocks, up to the last node
+
+unsigned heap_sort_blocked_space (unsigned size)
+{
+    return bheap_position (size-1) + 1;
+}
+
 // Sorting by the "comb" method
 //     Stable:                no
 //     Max complexity:        O(N*N) (it might be O(N*log N),
@@ -346,10 +670,10 @@ static const unsigned long combs[] =
 //     Average complexity:    O(N*log N)
 //     Min complexity:        O(N*log N)
 //     Other considerations:  It needs O(N) additional memory.
-//                            One version (natural mergesort) is
-//                            O(N) min, but that version makes a
-//                            less efficient use of the cache in
-//                            the average case.
+//                            One version (natural mergesort,
+//                            below) is O(N) min, but that version
+//                            makes a less efficient use of the
+//                            cache in the average case.
 
 static unsigned merge_sort_r (void * p, unsigned size,
                               unsigned dest, unsigned temp,
@@ -370,6 +694,13 @@ unsigned merge_sort (void * p, unsigned size,
     return size + merge_sort_r (p, size, 0, size, plesserthan, pread, pwrite);
 }
 
+// The array and the temporary one
+
+unsigned merge_sort_space (unsigned size)
+{
+    return 2*size;
+}
+
 static unsigned merge_sort_r (void * p, unsigned size,
                               unsigned dest, unsigned temp,
                               function_lesser_than * plesserthan,
@@ -440,99 +771,841 @@ static unsigned merge_sort_r (void * p, unsigned size,
     return iter;
 }
 
-// Sorting by the "quick" method
-//     Stable:                no
-//     Max complexity:        O(N*N)      <<-- (that's bad)
+// Natural mergesort
+//     Stable:                yes
+//     Max complexity:        O(N*log N)
 //     Average complexity:    O(N*log N)
-//     Min complexity:        O(N*log N)
-//     Other considerations:  It's the most popular. The problem of
-//                            its O(N*N) worst case complexity is
-//                            solved by switching to heapsort when
-//                            things get ugly. It's also usual to
-//                            switch to insertionsort when the
-//                            number of elements is small (lesser
-//                            than 8, for example)
+//     Min complexity:        O(N)
+//     Other considerations:  Instead of halving the array, it
+//                            merges the runs already sorted in
+//                            the data, by pairs, from the array
+//                            to the temporary one and back, until
+//                            only one is left. A sorted array is
+//                            a single run: it's only read. But
+//                            the runs are found again in every
+//                            pass, and each pass goes over the
+//                            whole array, instead of staying in
+//                            the cache as the mergesort above.
+
+// Length of the ascending run from 'from', up to 'end'
+
+static unsigned run_length (void * p, unsigned from, unsigned end,
+                            function_lesser_than * plesserthan,
+                            function_read * pread)
+{
+    unsigned u;
+    thing a, b;
 
-static unsigned quick_sort_r (void * p,
-                              unsigned from, unsigned size,
-                              unsigned pa,
-                              function_lesser_than * plesserthan,
-                              function_read * pread,
-                              function_write * pwrite);
+    for (a=pread(p,from), u=from+1; u<end; u++, a=b)
+    {
+        b = pread (p, u);
 
-unsigned quick_sort (void * p, unsigned size,
-                     function_lesser_than * plesserthan,
-                     function_read * pread,
-                     function_write * pwrite)
-{
-    return quick_sort_r (p, 0, size, 0, plesserthan, pread, pwrite);
-}
+        if (plesserthan(p,b,a))
+            break;
+    }
 
-unsigned quick_sort_pa (void * p, unsigned size,
-                        function_lesser_than * plesserthan,
-                        function_read * pread,
-                        function_write * pwrite)
-{
-    return quick_sort_r (p, 0, size, 1, plesserthan, pread, pwrite);
+    return u - from;
 }
 
-static unsigned my_random (unsigned from, unsigned size);
+// Merge the runs a (of left elements) and b (of right) into dest
 
-static unsigned quick_sort_r (void * p,
-                              unsigned from, unsigned size,
-                              unsigned pa,
-                              function_lesser_than * plesserthan,
-                              function_read * pread,
-                              function_write * pwrite)
+static unsigned merge_runs (void * p, unsigned a, unsigned left,
+                            unsigned b, unsigned right, unsigned dest,
+                            function_lesser_than * plesserthan,
+                            function_read * pread,
+                            function_write * pwrite)
 {
-    unsigned left, right, hole, iter;
-    thing a, pivot;
+    unsigned u, v;
+    thing x, y;
 
-    for (iter=0; size>1; )
-    {
-        iter += size;
+    x = pread (p, a);
+    y = pread (p, b);
 
-        if (pa)  // If requested, choose the pivot at random
+    for (u=v=0; u<left && v<right; )
+        if (plesserthan(p,y,x))
         {
-            hole = my_random (from, size);
-            pivot = pread (p, hole);
-            pwrite (p, hole, pread(p,from));
-            iter ++;
-        }
-        else                           // Otherwise, choose the
-            pivot = pread (p, from);   // first one as pivot
-
-        hole = from;
-        left = from + 1;
-        right = from + size - 1;
+            pwrite (p, dest++, y);
 
-        for (;;)
+            if (++v<right)
+                y = pread (p, b+v);
+        }
+        else
         {
-            do
-                a = pread (p, right);
-            while (plesserthan(p,pivot,a) && right-->left);
+            pwrite (p, dest++, x);
 
-            if (right<left)
-                break;
+            if (++u<left)
+                x = pread (p, a+u);
+        }
 
-            pwrite (p, hole, a);
-            hole = right--;
+    // The rest of one of them (the next one, read already)
+    if (u<left)
+        for (pwrite(p,dest++,x); ++u<left; )
+            pwrite (p, dest++, pread(p,a+u));
 
-            do
-                a = pread (p, left);
-            while (plesserthan(p,a,pivot) && left++<right);
+    if (v<right)
+        for (pwrite(p,dest++,y); ++v<right; )
+            pwrite (p, dest++, pread(p,b+v));
 
-            if (left>right)
-                break;
+    return left + right;
+}
 
-            pwrite (p, hole, a);
-            hole = left++;
-        }
+unsigned natural_merge_sort (void * p, unsigned size,
+                             function_lesser_than * plesserthan,
+                             function_read * pread,
+                             function_write * pwrite)
+{
+    unsigned u, v, left, right, from, to, iter;
 
-        pwrite (p, hole, pivot);
+    for (from=0, to=size, iter=0; ; u=from, from=to, to=u)
+    {
+        left = run_length (p, from, from+size, plesserthan, pread);
 
-        left = hole - from;
-        right = from + size - hole - 1;
+        if (left==size)         // A single run: sorted
+            break;
+
+        // A pass: merge each pair of runs into the other array
+        for (u=0; u<size; u+=left+right)
+        {
+            if (u)
+                left = run_length (p, from+u, from+size,
+                                   plesserthan, pread);
+
+            right = u+left<size ? run_length (p, from+u+left,
+                                              from+size,
+                                              plesserthan, pread)
+                                : 0;
+
+            if (right)
+                iter += merge_runs (p, from+u, left, from+u+left,
+                                    right, to+u, plesserthan, pread,
+                                    pwrite);
+            else
+                for (v=0; v<left; v++, iter++)
+                    pwrite (p, to+u+v, pread(p,from+u+v));
+        }
+    }
+
+    // Back to the array, if it ended in the temporary one
+    if (from)
+        for (u=0, iter+=size; u<size; u++)
+            pwrite (p, u, pread(p,size+u));
+
+    return iter;
+}
+
+// Sorting by the TimSort method (Tim Peters, for Python)
+//     Stable:                yes
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N)
+//     Other considerations:  A natural mergesort that reverses
+//                            the descending runs, and extends
+//                            the short ones to 'minrun' elements
+//                            (32 to 64) by binary insertion. The
+//                            runs are kept in a stack, and merged
+//                            as soon as their lengths stop
+//                            decreasing fast enough, so that the
+//                            merges are balanced and recent ones
+//                            are still in the cache. Only the
+//                            shorter run of each merge is copied
+//                            to the temporary array, which needs
+//                            half the size. When one run keeps
+//                            winning, the merge switches to
+//                            "galloping": an exponential search
+//                            for how many elements to move at
+//                            once, with only O(log N) comparisons.
+
+#define TIM_MIN_MERGE   64    // Arrays sorted by binary insertion
+#define TIM_MIN_GALLOP  7     // Wins before galloping
+#define TIM_MAX_RUNS    64    // Stack of runs (for 2^32 elements)
+
+typedef struct
+{
+    void * p;
+    function_lesser_than * plesserthan;
+    function_read * pread;
+    function_write * pwrite;
+    unsigned temp;           // Temporary array (size/2 elements)
+    unsigned mingallop;      // Wins before galloping, adapted
+    unsigned numruns;        // Runs waiting to be merged
+    unsigned base[TIM_MAX_RUNS], len[TIM_MAX_RUNS];
+    unsigned iter;
+}
+stimsort;
+
+// Length of the run from 'from', up to 'end': ascending, or
+// strictly descending, and then reversed (strictly, so that
+// reversing it keeps the sort stable)
+
+static unsigned tim_run (stimsort * T, unsigned from, unsigned end)
+{
+    void * p = T->p;
+    unsigned u, v, w;
+    thing a, b;
+
+    if (from+1==end)
+        return 1;
+
+    a = T->pread (p, from);
+    b = T->pread (p, from+1);
+
+    if (!T->plesserthan(p,b,a))
+        return 1 + run_length (p, from+1, end, T->plesserthan,
+                               T->pread);
+
+    for (u=from+2, a=b; u<end; u++, a=b)
+    {
+        b = T->pread (p, u);
+
+        if (!T->plesserthan(p,b,a))
+            break;
+    }
+
+    for (v=from, w=u-1; v<w; v++, w--, T->iter++)
+    {
+        a = T->pread (p, v);
+        T->pwrite (p, v, T->pread(p,w));
+        T->pwrite (p, w, a);
+    }
+
+    return u - from;
+}
+
+// Sort from..end-1 by binary insertion, knowing that the
+// elements before 'start' are sorted already
+
+static void tim_insertion (stimsort * T, unsigned from,
+                           unsigned start, unsigned end)
+{
+    void * p = T->p;
+    unsigned u, left, right, middle;
+    thing a;
+
+    for (; start<end; start++)
+    {
+        a = T->pread (p, start);
+
+        // After the equal ones, to be stable
+        for (left=from, right=start; left<right; )
+        {
+            middle = left + (right-left)/2;
+
+            if (T->plesserthan(p,a,T->pread(p,middle)))
+                right = middle;
+            else
+                left = middle + 1;
+        }
+
+        for (u=start; u>left; u--, T->iter++)
+            T->pwrite (p, u, T->pread(p,u-1));
+
+        T->pwrite (p, left, a);
+    }
+}
+
+// Number of elements of the sorted run base..base+len-1 that go
+// before 'key': those not greater than it (after = 1, to place
+// the key after the equal ones) or lesser than it (after = 0).
+// The search gallops from the start of the run (or from its end,
+// if 'fromend'), by jumps of 1, 3, 7, 15... elements, and ends
+// with a binary search: O(log k) comparisons to find k.
+
+static unsigned tim_gallop (stimsort * T, thing key, unsigned base,
+                            unsigned len, int after, int fromend)
+{
+    void * p = T->p;
+    unsigned last, ofs, left, right, middle;
+    thing a;
+
+#define TIM_BEFORE(x) (a = T->pread(p,base+(x)), \
+                       after ? !T->plesserthan(p,key,a) \
+                             : T->plesserthan(p,a,key))
+
+    last = 0;
+    ofs = 1;
+
+    if (!fromend)
+    {
+        if (!TIM_BEFORE(0))
+            return 0;
+
+        while (ofs<len && TIM_BEFORE(ofs))
+        {
+            last = ofs;
+            ofs = 2*ofs + 1;
+        }
+
+        left = last + 1;
+        right = ofs<len ? ofs : len;
+    }
+    else
+    {
+        if (TIM_BEFORE(len-1))
+            return len;
+
+        while (ofs<len && !TIM_BEFORE(len-1-ofs))
+        {
+            last = ofs;
+            ofs = 2*ofs + 1;
+        }
+
+        left = ofs<len ? len-ofs : 0;
+        right = len - 1 - last;
+    }
+
+    // The first one not before the key, in left..right
+    while (left<right)
+    {
+        middle = left + (right-left)/2;
+
+        if (TIM_BEFORE(middle))
+            left = middle + 1;
+        else
+            right = middle;
+    }
+
+#undef TIM_BEFORE
+
+    return left;
+}
+
+// Move n elements, from 'from' on to 'to' on (backwards if
+// 'down', from the last ones)
+
+static void tim_move (stimsort * T, unsigned from, unsigned to,
+                      unsigned n, int down)
+{
+    unsigned u;
+
+    for (u=0; u<n; u++, T->iter++)
+        if (down)
+            T->pwrite (T->p, to-u, T->pread(T->p,from-u));
+        else
+            T->pwrite (T->p, to+u, T->pread(T->p,from+u));
+}
+
+// Merge the runs base1 (of len1 elements) and base2, which
+// follows it, when the first one is the shorter: it goes to the
+// temporary array, and the merge fills the hole from the start
+
+static void tim_merge_low (stimsort * T, unsigned base1,
+                           unsigned len1, unsigned base2,
+                           unsigned len2)
+{
+    void * p = T->p;
+    unsigned c1, c2, dest, count1, count2;
+    thing a, b;
+
+    tim_move (T, base1, T->temp, len1, 0);
+
+    c1 = T->temp;       // Next of each run
+    c2 = base2;
+    dest = base1;
+
+    for (;;)
+    {
+        // One at a time, until a run wins mingallop times in a
+        // row
+        count1 = count2 = 0;
+        a = T->pread (p, c1);
+        b = T->pread (p, c2);
+
+        while (count1<T->mingallop && count2<T->mingallop)
+        {
+            T->iter ++;
+
+            if (T->plesserthan(p,b,a))
+            {
+                T->pwrite (p, dest++, b);
+                c2 ++;
+                count1 = 0;
+                count2 ++;
+
+                if (!--len2)
+                    goto end;
+
+                b = T->pread (p, c2);
+            }
+            else
+            {
+                T->pwrite (p, dest++, a);
+                c1 ++;
+                count1 ++;
+                count2 = 0;
+
+                if (!--len1)
+                    goto end;
+
+                a = T->pread (p, c1);
+            }
+        }
+
+        // Galloping, while it pays
+        do
+        {
+            count1 = tim_gallop (T, b, c1, len1, 1, 0);
+            tim_move (T, c1, dest, count1, 0);
+            c1 += count1;
+            dest += count1;
+            len1 -= count1;
+
+            if (!len1)
+                goto end;
+
+            T->pwrite (p, dest++, b);
+            c2 ++;
+
+            if (!--len2)
+                goto end;
+
+            a = T->pread (p, c1);
+            count2 = tim_gallop (T, a, c2, len2, 0, 0);
+            tim_move (T, c2, dest, count2, 0);
+            c2 += count2;
+            dest += count2;
+            len2 -= count2;
+
+            if (!len2)
+                goto end;
+
+            T->pwrite (p, dest++, a);
+            c1 ++;
+
+            if (!--len1)
+                goto end;
+
+            b = T->pread (p, c2);
+
+            if (T->mingallop>1)
+                T->mingallop --;
+        }
+        while (count1>=TIM_MIN_GALLOP || count2>=TIM_MIN_GALLOP);
+
+        T->mingallop += 2;      // Harder to gallop again
+    }
+
+end:
+    // The rest of the second run is in place already
+    tim_move (T, c1, dest, len1, 0);
+}
+
+// The same, when the second run is the shorter: it goes to the
+// temporary array, and the merge fills the hole from the end
+
+static void tim_merge_high (stimsort * T, unsigned base1,
+                            unsigned len1, unsigned base2,
+                            unsigned len2)
+{
+    void * p = T->p;
+    unsigned c1, c2, dest, count1, count2;
+    thing a, b;
+
+    tim_move (T, base2, T->temp, len2, 0);
+
+    c1 = base1 + len1 - 1;      // Last of each run
+    c2 = T->temp + len2 - 1;
+    dest = base2 + len2 - 1;
+
+    for (;;)
+    {
+        count1 = count2 = 0;
+        a = T->pread (p, c1);
+        b = T->pread (p, c2);
+
+        while (count1<T->mingallop && count2<T->mingallop)
+        {
+            T->iter ++;
+
+            if (T->plesserthan(p,b,a))
+            {
+                T->pwrite (p, dest--, a);
+                c1 --;
+                count1 ++;
+                count2 = 0;
+
+                if (!--len1)
+                    goto end;
+
+                a = T->pread (p, c1);
+            }
+            else
+            {
+                T->pwrite (p, dest--, b);
+                c2 --;
+                count1 = 0;
+                count2 ++;
+
+                if (!--len2)
+                    goto end;
+
+                b = T->pread (p, c2);
+            }
+        }
+
+        do
+        {
+            // Those of the first run greater than b
+            count1 = len1 - tim_gallop (T, b, base1, len1, 1, 1);
+            tim_move (T, c1, dest, count1, 1);
+            c1 -= count1;
+            dest -= count1;
+            len1 -= count1;
+
+            if (!len1)
+                goto end;
+
+            T->pwrite (p, dest--, b);
+            c2 --;
+
+            if (!--len2)
+                goto end;
+
+            // Those of the second run not lesser than a
+            a = T->pread (p, c1);
+            count2 = len2 - tim_gallop (T, a, T->temp, len2, 0, 1);
+            tim_move (T, c2, dest, count2, 1);
+            c2 -= count2;
+            dest -= count2;
+            len2 -= count2;
+
+            if (!len2)
+                goto end;
+
+            T->pwrite (p, dest--, a);
+            c1 --;
+
+            if (!--len1)
+                goto end;
+
+            b = T->pread (p, c2);
+
+            if (T->mingallop>1)
+                T->mingallop --;
+        }
+        while (count1>=TIM_MIN_GALLOP || count2>=TIM_MIN_GALLOP);
+
+        T->mingallop += 2;
+    }
+
+end:
+    // The rest of the first run is in place already
+    tim_move (T, c2, dest, len2, 1);
+}
+
+// Merge the runs i and i+1 of the stack
+
+static void tim_merge_at (stimsort * T, unsigned i)
+{
+    unsigned base1 = T->base[i], len1 = T->len[i];
+    unsigned base2 = T->base[i+1], len2 = T->len[i+1];
+    unsigned k;
+
+    T->len[i] = len1 + len2;
+
+    if (i+3==T->numruns)
+    {
+        T->base[i+1] = T->base[i+2];
+        T->len[i+1] = T->len[i+2];
+    }
+
+    T->numruns --;
+
+    // The start of the first run, up to the place of the first
+    // of the second, and the end of the second, from the place
+    // of the last of the first, are in place already
+    k = tim_gallop (T, T->pread(T->p,base2), base1, len1, 1, 0);
+    base1 += k;
+    len1 -= k;
+
+    if (!len1)
+        return;
+
+    len2 = tim_gallop (T, T->pread(T->p,base1+len1-1), base2, len2,
+                       0, 1);
+
+    if (!len2)
+        return;
+
+    if (len1<=len2)
+        tim_merge_low (T, base1, len1, base2, len2);
+    else
+        tim_merge_high (T, base1, len1, base2, len2);
+}
+
+// Merge the runs on top of the stack until their lengths
+// decrease at least as fast as the Fibonacci numbers (checking
+// the top four, as the top three are not enough)
+
+static void tim_collapse (stimsort * T)
+{
+    unsigned n, * len = T->len;
+
+    while (T->numruns>1)
+    {
+        n = T->numruns - 2;
+
+        if ((n>0 && len[n-1]<=len[n]+len[n+1]) ||
+            (n>1 && len[n-2]<=len[n-1]+len[n]))
+        {
+            if (len[n-1]<len[n+1])
+                n --;
+        }
+        else if (len[n]>len[n+1])
+            break;
+
+        tim_merge_at (T, n);
+    }
+}
+
+unsigned tim_sort (void * p, unsigned size,
+                   function_lesser_than * plesserthan,
+                   function_read * pread,
+                   function_write * pwrite)
+{
+    stimsort T;
+    unsigned u, n, len, minrun;
+
+    T.p = p;
+    T.plesserthan = plesserthan;
+    T.pread = pread;
+    T.pwrite = pwrite;
+    T.temp = size;
+    T.mingallop = TIM_MIN_GALLOP;
+    T.numruns = 0;
+    T.iter = 0;
+
+    // The shortest run, so that size/minrun is a power of 2 or
+    // a bit less (and the merges are balanced)
+    for (n=size, u=0; n>=TIM_MIN_MERGE; n>>=1)
+        u |= n & 1;
+
+    minrun = n + u;
+
+    for (u=0; u<size; u+=len)
+    {
+        len = tim_run (&T, u, size);
+
+        if (len<minrun)
+        {
+            n = size-u<minrun ? size-u : minrun;
+            tim_insertion (&T, u, u+len, u+n);
+            len = n;
+        }
+
+        T.base[T.numruns] = u;
+        T.len[T.numruns++] = len;
+        tim_collapse (&T);
+    }
+
+    while (T.numruns>1)
+    {
+        n = T.numruns - 2;
+
+        if (n>0 && T.len[n-1]<T.len[n+1])
+            n --;
+
+        tim_merge_at (&T, n);
+    }
+
+    return T.iter;
+}
+
+// The array and the temporary one, for the shorter run of each
+// merge
+
+unsigned tim_sort_space (unsigned size)
+{
+    return size + size/2;
+}
+
+// Sorting by blocks sorted with a bitonic network, merged
+//     Stable:                no
+//     Max complexity:        O(N*log N)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  Each block of B elements is read,
+//                            sorted in the registers of the
+//                            processor by a bitonic network of
+//                            B*log2(B)*(log2(B)+1)/4 compare-
+//                            exchanges, without branches, and
+//                            written back, so its trace is just
+//                            B reads and B writes: the network
+//                            doesn't use the comparison function,
+//                            and its comparisons are not counted.
+//                            The blocks are then merged by pairs,
+//                            as in the mergesort, back and forth
+//                            with a temporary array of the same
+//                            size. The network makes the same
+//                            comparisons whatever the data, so it
+//                            does more than the insertion sort of
+//                            an almost sorted block, but they are
+//                            done several at a time by the
+//                            vector instructions.
+
+static unsigned bitonic_elements = BITONIC_BLOCK;
+
+void bitonic_sort_block (unsigned elements)
+{
+    // Rounded down to a power of 2
+    for (bitonic_elements=BITONIC_MIN_BLOCK;
+         bitonic_elements*2<=elements; bitonic_elements*=2)
+        ;
+}
+
+unsigned bitonic_sort (void * p, unsigned size,
+                       function_lesser_than * plesserthan,
+                       function_read * pread,
+                       function_write * pwrite)
+{
+    thing block[BITONIC_MAX_BLOCK];
+    unsigned u, v, n, left, right, width, from, to, iter;
+
+    for (u=iter=0; u<size; u+=n)
+    {
+        n = size-u<bitonic_elements ? size-u : bitonic_elements;
+
+        // The last block, filled up with infinites
+        for (v=0; v<bitonic_elements; v++)
+            block[v] = v<n ? pread (p, u+v) : HUGE_VAL;
+
+        bitonic_block (block, bitonic_elements);
+
+        for (v=0; v<n; v++, iter++)
+            pwrite (p, u+v, block[v]);
+    }
+
+    for (from=0, to=size, width=bitonic_elements; width<size;
+         width*=2, v=from, from=to, to=v)
+        for (u=0; u<size; u+=left+right)
+        {
+            left = size-u<width ? size-u : width;
+            right = size-u-left<width ? size-u-left : width;
+
+            if (right)
+                iter += merge_runs (p, from+u, left, from+u+left,
+                                    right, to+u, plesserthan, pread,
+                                    pwrite);
+            else
+                for (v=0; v<left; v++, iter++)
+                    pwrite (p, to+u+v, pread(p,from+u+v));
+        }
+
+    // Back to the array, if it ended in the temporary one
+    if (from)
+        for (u=0, iter+=size; u<size; u++)
+            pwrite (p, u, pread(p,size+u));
+
+    return iter;
+}
+
+// Sorting by the "quick" method
+//     Stable:                no
+//     Max complexity:        O(N*N)      <<-- (that's bad)
+//     Average complexity:    O(N*log N)
+//     Min complexity:        O(N*log N)
+//     Other considerations:  It's the most popular. The problem of
+//                            its O(N*N) worst case complexity is
+//                            solved by switching to heapsort when
+//                            things get ugly. It's also usual to
+//                            switch to insertionsort when the
+//                            number of elements is small (lesser
+//                            than 8, for example)
+
+static unsigned quick_sort_r (void * p,
+                              unsigned from, unsigned size,
+                              sxoshiro * pa,
+                              function_lesser_than * plesserthan,
+                              function_read * pread,
+                              function_write * pwrite);
+
+unsigned quick_sort (void * p, unsigned size,
+                     function_lesser_than * plesserthan,
+                     function_read * pread,
+                     function_write * pwrite)
+{
+    return quick_sort_r (p, 0, size, NULL, plesserthan, pread,
+                         pwrite);
+}
+
+unsigned quick_sort_pa (void * p, unsigned size,
+                        function_lesser_than * plesserthan,
+                        function_read * pread,
+                        function_write * pwrite)
+{
+    return quick_sort_pa_seeded (p, size, 0, plesserthan, pread,
+                                 pwrite);
+}
+
+unsigned quick_sort_pa_seeded (void * p, unsigned size,
+                               unsigned long long seed,
+                               function_lesser_than * plesserthan,
+                               function_read * pread,
+                               function_write * pwrite)
+{
+    sxoshiro random;
+
+    // Every sort draws the same pivots, from the seed
+    xoshiro_seed (&random, seed);
+
+    return quick_sort_r (p, 0, size, &random, plesserthan, pread,
+                         pwrite);
+}
+
+static unsigned quick_sort_r (void * p,
+                              unsigned from, unsigned size,
+                              sxoshiro * pa,
+                              function_lesser_than * plesserthan,
+                              function_read * pread,
+                              function_write * pwrite)
+{
+    unsigned left, right, hole, iter;
+    thing a, pivot;
+
+    for (iter=0; size>1; )
+    {
+        iter += size;
+
+        if (pa)  // If requested, choose the pivot at random
+        {
+            hole = from + xoshiro_below (pa, size);
+            pivot = pread (p, hole);
+            pwrite (p, hole, pread(p,from));
+            iter ++;
+        }
+        else                           // Otherwise, choose the
+            pivot = pread (p, from);   // first one as pivot
+
+        hole = from;
+        left = from + 1;
+        right = from + size - 1;
+
+        for (;;)
+        {
+            do
+                a = pread (p, right);
+            while (plesserthan(p,pivot,a) && right-->left);
+
+            if (right<left)
+                break;
+
+            pwrite (p, hole, a);
+            hole = right--;
+
+            do
+                a = pread (p, left);
+            while (plesserthan(p,a,pivot) && left++<right);
+
+            if (left>right)
+                break;
+
+            pwrite (p, hole, a);
+            hole = left++;
+        }
+
+        pwrite (p, hole, pivot);
+
+        left = hole - from;
+        right = from + size - hole - 1;
 
         if (left>right)
         {
@@ -554,18 +1627,249 @@ static unsigned quick_sort_r (void * p,
     return iter;
 }
 
-static unsigned my_random (unsigned from, unsigned size)
+// Sorting by distribution of the keys in buckets, by their
+// digits (radix) or by their whole value (counting)
+//     Stable:                yes
+//     Max complexity:        O(N*K/D)   (keys of K bits, digits
+//     Average complexity:    O(N*K/D)    of D bits)
+//     Min complexity:        O(N)
+//     Other considerations:  They don't compare the keys, but
+//                            take their digits, so the keys must
+//                            be integers from 0 to 2^32-1 (as in
+//                            all the initial orders). Like the
+//                            mergesort, they need a temporary
+//                            array after the data, and after it
+//                            the counters of the buckets, which
+//                            are read and written like any other
+//                            element. The scatter of the keys to
+//                            the buckets jumps all over the
+//                            temporary array: with 2^D buckets,
+//                            it touches up to 2^D pages at a
+//                            time.
+
+static unsigned radix_bits = RADIX_BITS;
+
+void radix_sort_digit (unsigned bits)
+{
+    radix_bits = bits;
+}
+
+// Digit of the key a, from the bit 'shift'
+
+static unsigned digit (thing a, unsigned shift)
+{
+    return (unsigned) a >> shift & ((1U<<radix_bits) - 1);
+}
+
+// Number of digits of the largest key (1 at least), found with
+// size-1 comparisons
+
+static unsigned radix_passes (void * p, unsigned size,
+                              function_lesser_than * plesserthan,
+                              function_read * pread)
+{
+    unsigned u, passes, max;
+    thing a, b;
+
+    for (a=pread(p,0), u=1; u<size; u++)
+    {
+        b = pread (p, u);
+
+        if (plesserthan(p,a,b))
+            a = b;
+    }
+
+    max = (unsigned) a;
+
+    for (passes=1; passes*radix_bits<32 &&
+                   max>>(passes*radix_bits); passes++)
+        ;
+
+    return passes;
+}
+
+// Move the keys from..from+size-1 to their buckets, from 'temp'
+// on, by the digit at 'shift' (or by their value if 'shift' is
+// -1: a bucket per key, which must be below numbuckets). The
+// counters, from 'counters' on, end with the end of each
+// bucket.
+
+static unsigned distribute (void * p, unsigned from, unsigned size,
+                            unsigned temp, unsigned counters,
+                            unsigned numbuckets, int shift,
+                            function_read * pread,
+                            function_write * pwrite)
+{
+    unsigned u, b, pos, count;
+    thing a;
+
+    // Count the keys of each bucket
+    for (b=0; b<numbuckets; b++)
+        pwrite (p, counters+b, 0);
+
+    for (u=0; u<size; u++)
+    {
+        a = pread (p, from+u);
+        b = shift<0 ? (unsigned) a : digit (a, shift);
+
+        // A key without a bucket would be written out of the
+        // temporary array (gen_trace never gives one)
+        assert (b<numbuckets);
+
+        pwrite (p, counters+b, pread(p,counters+b)+1);
+    }
+
+    // Each counter, to the start of its bucket
+    for (pos=b=0; b<numbuckets; b++)
+    {
+        count = (unsigned) pread (p, counters+b);
+        pwrite (p, counters+b, pos);
+        pos += count;
+    }
+
+    // Scatter the keys, in the same order (stable)
+    for (u=0; u<size; u++)
+    {
+        a = pread (p, from+u);
+        b = shift<0 ? (unsigned) a : digit (a, shift);
+        pos = (unsigned) pread (p, counters+b);
+        pwrite (p, counters+b, pos+1);
+        pwrite (p, temp+pos, a);
+    }
+
+    return 3*size + 2*numbuckets;
+}
+
+// LSD (least significant digit first): a stable distribution
+// by each digit, from the lowest one, moving the keys from the
+// array to the temporary one and back
+
+unsigned lsd_radix_sort (void * p, unsigned size,
+                         function_lesser_than * plesserthan,
+                         function_read * pread,
+                         function_write * pwrite)
+{
+    unsigned u, passes, shift, from, to, iter;
+
+    passes = radix_passes (p, size, plesserthan, pread);
+
+    for (shift=from=iter=0, to=size; passes--; shift+=radix_bits)
+    {
+        iter += distribute (p, from, size, to, 2*size,
+                            1U<<radix_bits, shift, pread, pwrite);
+        u = from;
+        from = to;
+        to = u;
+    }
+
+    // After an odd number of passes, they are in the temporary
+    // array
+    if (from)
+        for (u=0, iter+=size; u<size; u++)
+            pwrite (p, u, pread(p,size+u));
+
+    return iter;
+}
+
+// MSD (most significant digit first): distribute by the highest
+// digit, and then sort each bucket by the next digits, on its
+// own. Small buckets are sorted by insertion instead, as the
+// counters would cost more than the keys. Each level of the
+// recursion has its own counters, as those of the upper level
+// still hold where its buckets end.
+
+#define MSD_CUTOFF 16   // Buckets sorted by insertion
+
+static unsigned msd_radix_sort_r (void * p,
+                                  unsigned from, unsigned size,
+                                  unsigned shift, unsigned counters,
+                                  unsigned temp,
+                                  function_lesser_than * plesserthan,
+                                  function_read * pread,
+                                  function_write * pwrite)
 {
-    unsigned n;
+    unsigned u, b, start, end, iter, numbuckets = 1U<<radix_bits;
+
+    if (size<MSD_CUTOFF)
+        return insertion_sort_r (p, from, size, plesserthan, pread,
+                                 pwrite);
+
+    iter = distribute (p, from, size, temp, counters, numbuckets,
+                       shift, pread, pwrite);
 
-    n = from + (unsigned)(rand()/(RAND_MAX+1.0)*size);
+    // Back from the buckets (in the temporary array) to the
+    // array
+    for (u=0, iter+=size; u<size; u++)
+        pwrite (p, from+u, pread(p,temp+u));
 
-    if (n>from+size-1)
-        n = from+size-1;
-    else if (n<from)
-        n = from;
+    if (!shift)
+        return iter;
 
-    return n;
+    for (start=from, b=0; b<numbuckets; b++, start=end)
+    {
+        end = from + (unsigned) pread (p, counters+b);
+
+        if (end-start>1)
+            iter += msd_radix_sort_r (p, start, end-start,
+                                      shift-radix_bits,
+                                      counters+numbuckets,
+                                      temp+start-from,
+                                      plesserthan, pread, pwrite);
+    }
+
+    return iter;
 }
 
+unsigned msd_radix_sort (void * p, unsigned size,
+                         function_lesser_than * plesserthan,
+                         function_read * pread,
+                         function_write * pwrite)
+{
+    unsigned passes;
+
+    passes = radix_passes (p, size, plesserthan, pread);
+
+    return msd_radix_sort_r (p, 0, size, (passes-1)*radix_bits,
+                             2*size, size, plesserthan, pread,
+                             pwrite);
+}
 
+// Counting: a bucket for each key from 0 to size-1, so the keys
+// must be below the size (gen_trace refuses the initial states
+// that would give larger ones). That is, a single pass of radix
+// with the whole key as the digit.
+
+unsigned counting_sort (void * p, unsigned size,
+                        function_lesser_than * plesserthan,
+                        function_read * pread,
+                        function_write * pwrite)
+{
+    unsigned u, iter;
+
+    iter = distribute (p, 0, size, size, 2*size, size, -1, pread,
+                       pwrite);
+
+    for (u=0; u<size; u++)
+        pwrite (p, u, pread(p,size+u));
+
+    return iter + size;
+}
+
+// Elements that they need: the array, the temporary one and the
+// counters
+
+unsigned lsd_radix_sort_space (unsigned size)
+{
+    return 2*size + (1U<<radix_bits);
+}
+
+unsigned msd_radix_sort_space (unsigned size)
+{
+    // A level of counters for each digit of 32 bits
+    return 2*size + (32+radix_bits-1) / radix_bits * (1U<<radix_bits);
+}
+
+unsigned counting_sort_space (unsigned size)
+{
+    return 3*size;
+}
@@ -33,4 +33,66 @@ typedef unsigned function_sort(void *, unsigned size,
 function_sort bubble_sort, insertion_sort, selection_sort, heap_sort, comb_sort,
     merge_sort, quick_sort, quick_sort_pa;
 
+// Heapsort with 4 or 8 children per node, and with the heap in
+// blocks of HEAP_BLOCK elements (a power of 2, up to
+// HEAP_MAX_BLOCK), each one a subtree:
+
+function_sort heap_sort_4, heap_sort_8, heap_sort_blocked;
+
+#define HEAP_BLOCK 16
+#define HEAP_MAX_BLOCK 4096
+
+void heap_sort_block(unsigned elements);
+
+// Natural mergesort and TimSort (which only needs half the size
+// of temporary space):
+
+function_sort natural_merge_sort, tim_sort;
+
+// Mergesort of blocks of BITONIC_BLOCK elements (a power of 2,
+// from BITONIC_MIN_BLOCK to BITONIC_MAX_BLOCK), each one sorted
+// by a bitonic network in the registers (see bitonic.h):
+
+function_sort bitonic_sort;
+
+#define BITONIC_BLOCK 16
+#define BITONIC_MIN_BLOCK 8
+#define BITONIC_MAX_BLOCK 64
+
+void bitonic_sort_block(unsigned elements);
+
+// Other sorting functions, by distribution of the keys instead of
+// comparisons (they must be integers from 0 to 2^32-1):
+
+function_sort lsd_radix_sort, msd_radix_sort, counting_sort;
+
+// Width of the digits of the radix sorts, in bits (1 to
+// RADIX_MAX_BITS):
+
+#define RADIX_BITS 8
+#define RADIX_MAX_BITS 16
+
+void radix_sort_digit(unsigned bits);
+
+// Type of functions that give the number of elements that an
+// algorithm needs: the array to sort, and the temporary space
+// after it. Those without one only need the size.
+
+typedef unsigned function_sort_space(unsigned size);
+
+function_sort_space heap_sort_blocked_space, merge_sort_space,
+    tim_sort_space, lsd_radix_sort_space, msd_radix_sort_space,
+    counting_sort_space;
+
+// quick_sort_pa with the random pivots drawn from the given seed
+// (quick_sort_pa uses 0). They come from a generator of its own,
+// started in every sort, so the same seed always gives the same
+// pivots:
+
+unsigned quick_sort_pa_seeded(void *, unsigned size,
+                              unsigned long long seed,
+                              function_lesser_than *plesserthan,
+                              function_read *pread,
+                              function_write *pwrite);
+
 #endif  // SORT_H_
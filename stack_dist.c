@@ -0,0 +1,281 @@
+/*
+    stack_dist.c
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stack_dist.h"
+
+#define STACK_NONE  (~0U)   // Page not in the stack, free slot,
+                            // empty entry of the hash table
+
+// Functions of the Fenwick tree (index i = slot i-1)
+
+static void tree_add (sstack * K, unsigned i, int delta)
+{
+    for (; i<=K->numslots; i+=i&-i)
+        K->tree[i] += delta;
+}
+
+static unsigned tree_sum (const sstack * K, unsigned i)
+{
+    unsigned sum = 0;
+
+    for (; i>0; i-=i&-i)
+        sum += K->tree[i];
+
+    return sum;
+}
+
+// Home of the page in the hash table: the upper bits of a
+// multiplicative hash (Knuth), as the lower ones would map
+// pages at strides of a power of 2 to a few entries
+
+static unsigned hash_page (const sstack * K, unsigned page)
+{
+    return (page * 2654435761U) >> K->shift;
+}
+
+// Entry of the page in 'slot': the page itself, or its place
+// in the hash table (linear probing), which is taken if the
+// page is not there
+
+static unsigned entry (sstack * K, unsigned page)
+{
+    unsigned i;
+
+    if (!K->keys)
+        return page;
+
+    i = hash_page (K, page);
+
+    while (K->keys[i]!=page && K->keys[i]!=STACK_NONE)
+        i = (i+1) & K->mask;
+
+    if (K->keys[i]==STACK_NONE)
+    {
+        K->keys[i] = page;
+        K->slot[i] = STACK_NONE;
+    }
+
+    return i;
+}
+
+// Reserve the arrays for 'numpages' pages and 'tablesize'
+// entries of the hash table (0 = no table)
+
+static int reserve (sstack * K, unsigned numpages,
+                    unsigned tablesize)
+{
+    unsigned numentries = tablesize ? tablesize : numpages;
+
+    K->numpages = numpages;
+    K->numslots = numpages<32 ? 64 : 2*numpages;
+    K->nextslot = K->numlive = 0;
+    K->mask = tablesize-1;
+
+    for (K->shift=32; tablesize>1U<<(32-K->shift); K->shift--)
+        ;
+
+    K->slot = (unsigned*) malloc (numentries*sizeof(unsigned));
+    K->owner = (unsigned*) malloc (K->numslots*sizeof(unsigned));
+    K->tree = (unsigned*) calloc (K->numslots+1, sizeof(unsigned));
+    K->keys = tablesize ? (unsigned*) malloc (tablesize *
+                                              sizeof(unsigned))
+                        : NULL;
+
+    if (!K->slot || !K->owner || !K->tree ||
+        (tablesize && !K->keys))
+    {
+        stack_free (K);
+        return -1;
+    }
+
+    memset (K->slot, 0xff, numentries*sizeof(unsigned));
+
+    if (K->keys)
+        memset (K->keys, 0xff, tablesize*sizeof(unsigned));
+
+    return 0;
+}
+
+int stack_init (sstack * K, unsigned numpages)
+{
+    return reserve (K, numpages, 0);
+}
+
+int stack_init_sparse (sstack * K, unsigned maxpages)
+{
+    unsigned size;
+
+    for (size=64; size<2*maxpages; size*=2)
+        ;
+
+    return reserve (K, maxpages, size);
+}
+
+void stack_free (sstack * K)
+{
+    free (K->slot);
+    free (K->owner);
+    free (K->tree);
+    free (K->keys);
+
+    K->slot = K->owner = K->tree = K->keys = NULL;
+}
+
+// Move the marks to the lowest slots, keeping their order,
+// and rebuild the tree in linear time
+
+static void compact (sstack * K)
+{
+    unsigned s, n, i, j;
+
+    for (s=n=0; s<K->nextslot; s++)
+        if (K->owner[s]!=STACK_NONE)
+        {
+            K->owner[n] = K->owner[s];
+            K->slot[entry(K,K->owner[n])] = n;
+            n ++;
+        }
+
+    K->nextslot = n;
+
+    memset (K->tree, 0, (K->numslots+1)*sizeof(unsigned));
+
+    for (i=1; i<=n; i++)
+        K->tree[i] = 1;
+
+    for (i=1; i<=K->numslots; i++)
+    {
+        j = i + (i&-i);
+
+        if (j<=K->numslots)
+            K->tree[j] += K->tree[i];
+    }
+}
+
+int stack_grow (sstack * K, unsigned maxpages)
+{
+    sstack new;
+    unsigned s;
+
+    if (!K->keys || maxpages<=K->numpages)
+        return 0;
+
+    if (stack_init_sparse(&new,maxpages)<0)
+        return -1;
+
+    // Copy the marks in order; compact() puts the pages in
+    // the new table
+    for (s=0; s<K->nextslot; s++)
+        new.owner[s] = K->owner[s];
+
+    new.nextslot = K->nextslot;
+    new.numlive = K->numlive;
+
+    stack_free (K);
+    *K = new;
+    compact (K);
+
+    return 0;
+}
+
+unsigned stack_reference (sstack * K, unsigned page)
+{
+    unsigned e = entry (K, page), s = K->slot[e], dist;
+
+    // Already on top: nothing moves (the most common case)
+    if (s!=STACK_NONE && s+1==K->nextslot)
+        return 1;
+
+    if (s==STACK_NONE)
+    {
+        dist = STACK_COLD;
+        K->numlive ++;
+    }
+    else
+    {
+        // Marks above the page's, plus its own
+        dist = K->numlive - tree_sum(K,s+1) + 1;
+
+        tree_add (K, s+1, -1);
+        K->owner[s] = STACK_NONE;
+    }
+
+    if (K->nextslot==K->numslots)
+        compact (K);
+
+    s = K->nextslot++;
+    K->slot[e] = s;
+    K->owner[s] = page;
+    tree_add (K, s+1, 1);
+
+    return dist;
+}
+
+unsigned stack_page_at (const sstack * K, unsigned dist)
+{
+    unsigned k = K->numlive - dist + 1, i = 0, step;
+
+    // The slot of the k-th mark from the bottom: go down the
+    // tree, skipping the subtrees with fewer marks
+    for (step=1; step*2<=K->numslots; step*=2)
+        ;
+
+    for (; step; step/=2)
+        if (i+step<=K->numslots && K->tree[i+step]<k)
+        {
+            i += step;
+            k -= K->tree[i];
+        }
+
+    return K->owner[i];
+}
+
+void stack_remove (sstack * K, unsigned page)
+{
+    unsigned e = entry (K, page), s = K->slot[e], i, j, home;
+
+    if (s!=STACK_NONE)
+    {
+        tree_add (K, s+1, -1);
+        K->owner[s] = STACK_NONE;
+        K->numlive --;
+    }
+
+    K->slot[e] = STACK_NONE;
+
+    if (!K->keys)
+        return;
+
+    // Empty the entry, moving back the following entries that
+    // would not be found across the gap
+    K->keys[e] = STACK_NONE;
+
+    for (i=e, j=(e+1)&K->mask; K->keys[j]!=STACK_NONE;
+         j=(j+1)&K->mask)
+    {
+        home = hash_page (K, K->keys[j]);
+
+        if (((j-home) & K->mask) >= ((j-i) & K->mask))
+        {
+            K->keys[i] = K->keys[j];
+            K->slot[i] = K->slot[j];
+            K->keys[j] = STACK_NONE;
+            i = j;
+        }
+    }
+}
+
+unsigned stack_pages (sstack * K, unsigned * pages)
+{
+    unsigned s, n;
+
+    for (s=n=0; s<K->nextslot; s++)
+        if (K->owner[s]!=STACK_NONE)
+            pages[n++] = K->owner[s];
+
+    return n;
+}
@@ -0,0 +1,75 @@
+/*
+    stack_dist.h
+*/
+
+#ifndef _STACK_DIST_H_
+#define _STACK_DIST_H_
+
+// LRU stack of pages, for computing the stack distance of each
+// reference (Mattson et al.): the number of different pages
+// referenced since the previous reference to the same page,
+// including itself. A reference with distance d is a hit with
+// d frames or more, and a page fault with fewer.
+//
+// Each page keeps a mark in the slot of its last reference;
+// the distance is the number of marks from that slot up to the
+// top, counted with a Fenwick tree in O(log slots). Slots are
+// handed out in order, and when they run out the marks are
+// compacted to the bottom, keeping their order.
+//
+// The slot of each page is kept in an array indexed by page,
+// or, in sparse stacks, in a hash table that only holds the
+// pages in the stack: the memory is then proportional to
+// them, not to the whole address space.
+
+#define STACK_COLD  0U   // Distance of a first reference
+
+typedef struct
+{
+    unsigned numpages;    // # of pages (max. if sparse)
+    unsigned * slot;      // Slot of each page (if any)
+    unsigned * keys;      // Pages of the table (if sparse)
+    unsigned mask;        // Size of the table - 1
+    unsigned shift;       // 32 - bits of the size
+    unsigned * owner;     // Page of each slot (if any)
+    unsigned * tree;      // Fenwick tree of the marks
+    unsigned numslots;    // # of slots
+    unsigned nextslot;    // First free slot
+    unsigned numlive;     // # of pages in the stack
+}
+sstack;
+
+// Create an empty stack for 'numpages' pages. Return 0 if OK,
+// -1 if there is not enough memory.
+
+int stack_init (sstack * K, unsigned numpages);
+void stack_free (sstack * K);
+
+// Create an empty sparse stack, for pages of any number but
+// no more than 'maxpages' of them at once, and make room for
+// more later on. Return 0 if OK, -1 if there is not enough
+// memory.
+
+int stack_init_sparse (sstack * K, unsigned maxpages);
+int stack_grow (sstack * K, unsigned maxpages);
+
+// Move the page to the top of the stack and return its
+// distance, or STACK_COLD if it was not in the stack
+
+unsigned stack_reference (sstack * K, unsigned page);
+
+// Page at distance 'dist' (from 1, the top, to the number of
+// pages in the stack), without moving it
+
+unsigned stack_page_at (const sstack * K, unsigned dist);
+
+// Take the page out of the stack, if it is there
+
+void stack_remove (sstack * K, unsigned page);
+
+// Store in 'pages' the pages in the stack, from the least to
+// the most recently referenced, and return how many there are
+
+unsigned stack_pages (sstack * K, unsigned * pages);
+
+#endif // _STACK_DIST_H_
@@ -0,0 +1,610 @@
+/*
+    trace.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+#include "trace_codec.h"
+
+// Decoding and encoding of the little endian words of the
+// binary formats (compilers turn these into plain loads/stores
+// on little endian machines)
+
+static unsigned get_word (const unsigned char * p)
+{
+    return p[0] | p[1]<<8 | p[2]<<16 | (unsigned)p[3]<<24;
+}
+
+static unsigned long long get_dword (const unsigned char * p)
+{
+    return get_word(p) | (unsigned long long) get_word(p+4) << 32;
+}
+
+static void put_word (FILE * pf, unsigned w)
+{
+    unsigned char b[4];
+
+    b[0] = w;
+    b[1] = w>>8;
+    b[2] = w>>16;
+    b[3] = w>>24;
+
+    fwrite (b, 4, 1, pf);
+}
+
+static void put_dword (FILE * pf, unsigned long long w)
+{
+    put_word (pf, w);
+    put_word (pf, w>>32);
+}
+
+// Hand-written scanner for the text format, working directly
+// on the mapped bytes. A number that doesn't fit in an unsigned
+// is an error, as the trace is malformed.
+
+#define IS_SPACE(C) ((C)==' ' || (C)=='\n' || (C)=='\t' || (C)=='\r')
+#define IS_DIGIT(C) ((C)>='0' && (C)<='9')
+
+static int scan_number (strace * T, unsigned * n)
+{
+    const unsigned char * p = T->pos;
+    unsigned v;
+
+    while (p<T->end && IS_SPACE(*p))
+        p ++;
+
+    if (p==T->end || !IS_DIGIT(*p))
+        return 0;
+
+    for (v=0; p<T->end && IS_DIGIT(*p); p++)
+    {
+        if (v > (UINT_MAX - (*p-'0')) / 10)
+            return 0;
+
+        v = v*10 + (*p-'0');
+    }
+
+    T->pos = p;
+    *n = v;
+    return 1;
+}
+
+static int scan_op (strace * T, char * op)
+{
+    const unsigned char * p = T->pos;
+
+    while (p<T->end && IS_SPACE(*p))
+        p ++;
+
+    if (p==T->end)
+        return 0;
+
+    *op = *p;
+    T->pos = p+1;
+    return 1;
+}
+
+// Buffers for decoding compressed blocks
+
+static int reserve_buffers (strace * T)
+{
+    T->words = (unsigned*) malloc (TZ_BLOCK_OPS*sizeof(unsigned));
+    T->scratch = (unsigned char*) malloc (TZ_MAX_RAW);
+
+    if (T->pipe)
+        T->block = (unsigned char*) malloc (TZ_MAX_BLOCK);
+
+    if (T->words && T->scratch && (T->block || !T->pipe))
+        return 0;
+
+    errno = ENOMEM;
+    return -1;
+}
+
+// Fail because the data is not a trace (or is a broken one)
+
+static int malformed (void)
+{
+    errno = EINVAL;
+    return -1;
+}
+
+// Check the header, the trailer and the index of a mapped
+// compressed trace
+
+static int open_blocks (strace * T)
+{
+    const unsigned char * trailer;
+    unsigned long long offset;
+
+    if (T->size < 12+16 || get_word(T->data+8)!=TZ_BLOCK_OPS)
+        return malformed ();
+
+    trailer = T->end - 16;
+    offset = get_dword (trailer);
+    T->numblocks = get_word (trailer+8);
+
+    if (memcmp(trailer+12,TRACE_MAGIC_INDEX,4) ||
+        offset < 12 || offset > T->size-16 ||
+        (T->size-16-offset)/16 != T->numblocks)
+        return malformed ();
+
+    T->format = TRACE_BLOCKS;
+    T->totelem = get_word (T->data+4);
+    T->index = T->data + offset;
+    T->pos += 12;
+    T->end = T->index;          // Blocks end where index begins
+
+    return reserve_buffers (T);
+}
+
+int trace_open_file (strace * T, const char * path)
+{
+    struct stat st;
+    void * data;
+    int fd, error;
+    char op;
+
+    memset (T, 0, sizeof(*T));
+
+    fd = open (path, O_RDONLY);
+
+    if (fd<0)
+        return -1;
+
+    if (fstat(fd,&st)<0)
+        error = errno;
+    else
+        error = st.st_size==0 ? ENODATA : 0;
+
+    if (error)
+    {
+        close (fd);
+        errno = error;
+        return -1;
+    }
+
+    data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+
+    if (data==MAP_FAILED)
+        return -1;
+
+    // The trace is read once from the beginning to the end
+    madvise (data, st.st_size, MADV_SEQUENTIAL);
+
+    T->data = T->pos = (const unsigned char*) data;
+    T->size = st.st_size;
+    T->end = T->data + T->size;
+
+    if (T->size>=8 && !memcmp(T->data,TRACE_MAGIC,4))
+    {
+        T->format = TRACE_BINARY;
+        T->totelem = get_word (T->data+4);
+        T->pos += 8;
+        return 0;
+    }
+
+    if (T->size>=4 && !memcmp(T->data,TRACE_MAGIC_BLOCKS,4))
+    {
+        if (open_blocks(T)==0)
+            return 0;
+    }
+    else
+    {
+        T->format = TRACE_TEXT;
+
+        if (scan_op(T,&op) && op=='T' &&
+            scan_number(T,&T->totelem))
+            return 0;
+
+        malformed ();
+    }
+
+    // Whatever failed, not the unmapping
+    error = errno;
+    trace_close (T);
+    errno = error;
+    return -1;
+}
+
+int trace_open_pipe (strace * T, FILE * pipe)
+{
+    unsigned char header[12];
+    int c;
+
+    memset (T, 0, sizeof(*T));
+    T->pipe = pipe;
+
+    // Peek the first byte to tell the format
+
+    c = getc (pipe);
+
+    if (c==EOF)
+    {
+        if (!ferror(pipe))
+            errno = ENODATA;
+
+        return -1;
+    }
+
+    if (c==TRACE_MAGIC[0])
+    {
+        header[0] = c;
+
+        if (fread(header+1,7,1,pipe)!=1)
+            return malformed ();
+
+        T->totelem = get_word (header+4);
+
+        if (!memcmp(header,TRACE_MAGIC,4))
+        {
+            T->format = TRACE_BINARY;
+            return 0;
+        }
+
+        if (memcmp(header,TRACE_MAGIC_BLOCKS,4) ||
+            fread(header+8,4,1,pipe)!=1 ||
+            get_word(header+8)!=TZ_BLOCK_OPS)
+            return malformed ();
+
+        T->format = TRACE_BLOCKS;
+        return reserve_buffers (T);
+    }
+
+    ungetc (c, pipe);
+    T->format = TRACE_TEXT;
+
+    return fscanf(pipe," T %u",&T->totelem)==1 ? 0 : malformed ();
+}
+
+// Decode the next block of a compressed trace
+
+static int next_block (strace * T)
+{
+    size_t size;
+    int n;
+
+    T->nextword = T->numwords = 0;
+
+    if (T->pipe)
+    {
+        if (fread(T->block,TZ_HEADER_SIZE,1,T->pipe)!=1 ||
+            !(size = tz_block_size(T->block)) ||
+            fread(T->block+TZ_HEADER_SIZE,
+                  size-TZ_HEADER_SIZE,1,T->pipe)!=1)
+            return 0;
+
+        n = tz_decode_block (T->block, size, T->words,
+                             T->scratch, &size);
+    }
+    else
+    {
+        n = tz_decode_block (T->pos, T->end-T->pos, T->words,
+                             T->scratch, &size);
+
+        if (n>0)
+            T->pos += size;
+    }
+
+    if (n<=0)
+        return 0;
+
+    T->numwords = n;
+    return 1;
+}
+
+int trace_next (strace * T, char * op, unsigned * pos)
+{
+    unsigned char b[4];
+    unsigned w;
+
+    if (T->format==TRACE_BLOCKS)
+    {
+        if (T->nextword==T->numwords && !next_block(T))
+            return 0;
+
+        w = T->words[T->nextword++];
+    }
+    else if (T->format==TRACE_BINARY)
+    {
+        if (T->pipe)
+        {
+            if (fread(b,4,1,T->pipe)!=1)
+                return 0;
+
+            w = get_word (b);
+        }
+        else
+        {
+            if (T->end-T->pos < 4)
+                return 0;
+
+            w = get_word (T->pos);
+            T->pos += 4;
+        }
+    }
+    else if (T->pipe)
+    {
+        // Ignore spaces and read one character
+        if (fscanf(T->pipe," %c",op)!=1)
+            return 0;
+
+        if (*op=='R' || *op=='W')
+            return fscanf(T->pipe,"%u",pos)==1;
+
+        return 1;
+    }
+    else
+    {
+        if (!scan_op(T,op))
+            return 0;
+
+        if (*op=='R' || *op=='W')
+            return scan_number (T, pos);
+
+        return 1;
+    }
+
+    *pos = w & TRACE_MAX_POS;
+
+    switch (w>>30)
+    {
+        case TRACE_OP_READ:  *op = 'R'; break;
+        case TRACE_OP_WRITE: *op = 'W'; break;
+        case TRACE_OP_CMP:   *op = 'C'; break;
+        default:             *op = *pos ? 'O' : 'S';
+    }
+
+    return 1;
+}
+
+int trace_close (strace * T)
+{
+    int ok = 1;
+
+    if (T->data)
+        munmap ((void*) T->data, T->size);
+
+    if (T->pipe && T->closepipe && pclose(T->pipe)==-1)
+        ok = 0;
+
+    free (T->words);
+    free (T->scratch);
+    free (T->block);
+
+    memset (T, 0, sizeof(*T));
+
+    return ok ? 0 : -1;
+}
+
+// Random access to the blocks of a mapped trace
+
+unsigned trace_num_blocks (const strace * T)
+{
+    if (!T->data)
+        return 0;
+
+    if (T->format==TRACE_BINARY)
+        return ((T->end-T->data-8)/4 + TZ_BLOCK_OPS-1) / TZ_BLOCK_OPS;
+
+    return T->format==TRACE_BLOCKS ? T->numblocks : 0;
+}
+
+int trace_read_block (const strace * T, unsigned b,
+                      unsigned * words, unsigned char * scratch,
+                      unsigned long long * firstop)
+{
+    unsigned long long offset;
+    const unsigned char * p;
+    size_t size;
+    int n;
+
+    if (b >= trace_num_blocks(T))
+        return -1;
+
+    if (T->format==TRACE_BINARY)
+    {
+        *firstop = (unsigned long long) b * TZ_BLOCK_OPS;
+        p = T->data + 8 + 4 * *firstop;
+
+        for (n=0; n<TZ_BLOCK_OPS && T->end-p>=4; n++, p+=4)
+            words[n] = get_word (p);
+
+        return n;
+    }
+
+    offset = get_dword (T->index + 16*b);
+    *firstop = get_dword (T->index + 16*b + 8);
+
+    if (offset < 12 || offset >= (size_t)(T->index-T->data))
+        return -1;
+
+    return tz_decode_block (T->data+offset,
+                            T->index-T->data-offset,
+                            words, scratch, &size);
+}
+
+// Functions that write traces
+
+static unsigned make_word (char op, unsigned pos)
+{
+    return (op=='R' ? TRACE_OP_READ :
+            op=='W' ? TRACE_OP_WRITE :
+            op=='C' ? TRACE_OP_CMP :
+                      TRACE_OP_END)<<30 | pos;
+}
+
+static int flush_block (stracewriter * W)
+{
+    unsigned long long * index;
+    unsigned maxblocks;
+    size_t size;
+
+    if (!W->numwords)
+        return 0;
+
+    // The capacity grows only once the new index is there
+    if (W->numblocks==W->maxblocks)
+    {
+        maxblocks = W->maxblocks ? 2*W->maxblocks : 64;
+        index = (unsigned long long*)
+                realloc (W->index, 2*maxblocks*sizeof(*index));
+
+        if (!index)
+            return -1;
+
+        W->index = index;
+        W->maxblocks = maxblocks;
+    }
+
+    W->index[2*W->numblocks] = W->offset;
+    W->index[2*W->numblocks+1] = W->firstop;
+    W->numblocks ++;
+
+    size = tz_encode_block (W->words, W->numwords,
+                            W->block, W->scratch);
+    fwrite (W->block, size, 1, W->pf);
+
+    W->offset += size;
+    W->firstop += W->numwords;
+    W->numwords = 0;
+
+    return 0;
+}
+
+int trace_writer_open (stracewriter * W, FILE * pf, int format,
+                       unsigned totelem)
+{
+    memset (W, 0, sizeof(*W));
+
+    W->pf = pf;
+    W->format = format;
+
+    // Positions of 30 bits in the binary formats
+    if (format!=TRACE_TEXT && totelem-1>TRACE_MAX_POS)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    if (format==TRACE_BLOCKS)
+    {
+        W->words = (unsigned*) malloc (TZ_BLOCK_OPS*sizeof(unsigned));
+        W->block = (unsigned char*) malloc (TZ_MAX_BLOCK);
+        W->scratch = (unsigned char*) malloc (TZ_MAX_RAW);
+
+        if (!W->words || !W->block || !W->scratch)
+        {
+            trace_writer_close (W, 0);
+            return -1;
+        }
+
+        fwrite (TRACE_MAGIC_BLOCKS, 4, 1, pf);
+        put_word (pf, totelem);
+        put_word (pf, TZ_BLOCK_OPS);
+        W->offset = 12;
+    }
+    else if (format==TRACE_BINARY)
+    {
+        fwrite (TRACE_MAGIC, 4, 1, pf);
+        put_word (pf, totelem);
+    }
+    else
+        fprintf (pf, " T%u\n", totelem);
+
+    return ferror(pf) ? -1 : 0;
+}
+
+int trace_write_op (stracewriter * W, char op, unsigned pos)
+{
+    // After a failure nothing else is written
+    if (W->failed)
+        return -1;
+
+    if (W->format!=TRACE_TEXT && pos>TRACE_MAX_POS)
+    {
+        W->failed = 1;
+        return -1;
+    }
+
+    W->numops ++;
+
+    if (W->format==TRACE_BLOCKS)
+    {
+        W->words[W->numwords++] = make_word (op, pos);
+
+        if (W->numwords==TZ_BLOCK_OPS && flush_block(W)<0)
+            W->failed = 1;
+    }
+    else if (W->format==TRACE_BINARY)
+        put_word (W->pf, make_word(op,pos));
+    else
+    {
+        if (op=='C')
+            fprintf (W->pf, " C");
+        else
+            fprintf (W->pf, " %c%u", op, pos);
+
+        if ((W->numops & 7) == 0)
+            fputc ('\n', W->pf);
+    }
+
+    return W->failed ? -1 : 0;
+}
+
+int trace_writer_close (stracewriter * W, int sorted)
+{
+    unsigned b;
+    int ok = !W->failed;
+
+    // A trace that failed is left without its end
+    if (ok && W->format==TRACE_BLOCKS && W->words)
+    {
+        // End mark, last block, index and trailer
+        W->words[W->numwords++] = make_word ('S', !sorted);
+
+        if (W->numwords==TZ_BLOCK_OPS)
+            ok = flush_block(W)==0;
+
+        ok = ok && flush_block(W)==0;
+
+        if (ok)
+        {
+            for (b=0; b<2*W->numblocks; b++)
+                put_dword (W->pf, W->index[b]);
+
+            put_dword (W->pf, W->offset);
+            put_word (W->pf, W->numblocks);
+            fwrite (TRACE_MAGIC_INDEX, 4, 1, W->pf);
+        }
+    }
+    else if (ok && W->format==TRACE_BINARY)
+        put_word (W->pf, TRACE_OP_END<<30 | !sorted);
+    else if (ok && W->format==TRACE_TEXT)
+        fprintf (W->pf, " %s\n", sorted ? "Sorted ;-)"
+                                        : "Out of order :-(");
+
+    free (W->words);
+    free (W->block);
+    free (W->scratch);
+    free (W->index);
+
+    W->words = NULL;
+    W->block = W->scratch = NULL;
+    W->index = NULL;
+
+    if (fflush(W->pf)!=0 || ferror(W->pf))
+        ok = 0;
+
+    return ok ? 0 : -1;
+}
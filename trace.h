@@ -0,0 +1,145 @@
+/*
+    trace.h
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Formats of the traces
+//
+// Text: the output of gen_trace, " T<total>" followed by
+//       " R<pos>", " W<pos>" and " C", and ended by
+//       " Sorted ;-)" or " Out of order :-(".
+//
+// Binary: a header of 8 bytes (TRACE_MAGIC and the total
+//       number of elements) followed by one 32-bit word per
+//       operation. The 2 upper bits hold the operation, and the
+//       lower 30 the position; the end of the trace is marked
+//       with TRACE_OP_END, position 0 (sorted) or 1 (out of
+//       order). All words are little endian.
+//
+// Blocks: the words of the binary format, compressed in
+//       blocks of TZ_BLOCK_OPS operations (see trace_codec.h).
+//       A header of 12 bytes (TRACE_MAGIC_BLOCKS, the total
+//       number of elements and the operations per block) is
+//       followed by the blocks, and then by an index with the
+//       offset in the file and the number of the first
+//       operation of each block (two 64-bit words per block).
+//       The file ends with a trailer of 16 bytes: the offset
+//       of the index (64 bits), the number of blocks and
+//       TRACE_MAGIC_INDEX.
+
+#define TRACE_TEXT    0
+#define TRACE_BINARY  1
+#define TRACE_BLOCKS  2
+
+#define TRACE_MAGIC          "\177TRB"
+#define TRACE_MAGIC_BLOCKS   "\177TRZ"
+#define TRACE_MAGIC_INDEX    "TRZI"
+
+#define TRACE_OP_READ   0U
+#define TRACE_OP_WRITE  1U
+#define TRACE_OP_CMP    2U
+#define TRACE_OP_END    3U
+
+#define TRACE_MAX_POS   ((1U<<30)-1)
+
+// State of a trace being read, either from a pipe (usually
+// the output of gen_trace) or from a file mapped in memory
+
+typedef struct
+{
+    FILE * pipe;                  // Pipe (NULL if mapped)
+    int closepipe;                // 1 = trace_close closes it
+    const unsigned char * data;   // Mapped file (NULL if pipe)
+    size_t size;                  // Size of the mapped file
+    const unsigned char * pos;    // Next byte to parse
+    const unsigned char * end;    // End of the mapped file
+    int format;                   // TRACE_TEXT/BINARY/BLOCKS
+    unsigned totelem;             // Total # of elements
+
+    // Compressed blocks
+    unsigned * words;             // Operations of the block
+    unsigned numwords;            //  ... how many
+    unsigned nextword;            //  ... next one to read
+    unsigned char * scratch;      // Buffer for decoding
+    unsigned char * block;        // Block read from the pipe
+    const unsigned char * index;  // Index (NULL if pipe)
+    unsigned numblocks;           // Entries in the index
+}
+strace;
+
+// Open a trace and read its total # of elements.
+// Return 0 if OK, -1 otherwise, with errno set: ENODATA if it is
+// empty, EINVAL if it is not a trace, or that of the failed
+// call (open, mmap...).
+
+int trace_open_file (strace * T, const char * path);
+int trace_open_pipe (strace * T, FILE * pipe);
+
+// Read the next operation of the trace: 'R'ead, 'W'rite and
+// 'C'omparison, or 'S'orted and 'O'ut of order at the end.
+// The position is stored in *pos for 'R' and 'W'. Return 1 if
+// OK, 0 at the end of the data or if the trace is malformed.
+
+int trace_next (strace * T, char * op, unsigned * pos);
+
+// Unmap the file. A pipe must be closed by whoever opened it,
+// unless 'closepipe' is set. Return -1 if closing failed.
+
+int trace_close (strace * T);
+
+// Random access to the blocks of a mapped binary or compressed
+// trace (a binary trace is split in blocks of TZ_BLOCK_OPS
+// operations too; text traces and pipes have no blocks).
+// trace_read_block decodes block 'b' into 'words' (TZ_BLOCK_OPS
+// of them), using 'scratch' (TZ_MAX_RAW bytes), and stores in
+// *firstop the number of its first operation. It only reads
+// the mapped file, so several threads can call it at once,
+// each one with its own buffers. Return the number of
+// operations of the block, or -1 if it's malformed.
+
+unsigned trace_num_blocks (const strace * T);
+int trace_read_block (const strace * T, unsigned b,
+                      unsigned * words, unsigned char * scratch,
+                      unsigned long long * firstop);
+
+// State of a trace being written
+
+typedef struct
+{
+    FILE * pf;                    // Output
+    int format;                   // TRACE_TEXT/BINARY/BLOCKS
+    unsigned numops;              // Operations written
+
+    // Compressed blocks
+    unsigned * words;             // Operations of the block
+    unsigned numwords;            //  ... how many
+    unsigned char * block;        // Encoded block
+    unsigned char * scratch;      // Buffer for encoding
+    unsigned long long offset;    // Bytes written
+    unsigned long long firstop;   // First operation of the block
+    unsigned long long * index;   // Offset and first operation
+    unsigned numblocks;           //  ... of each block
+    unsigned maxblocks;           // Capacity of the index
+    int failed;                   // Some operation not written
+}
+stracewriter;
+
+// Write a trace in the given format: the header, the
+// operations ('R', 'W' or 'C') and, when closing, the end mark
+// ('S'orted or 'O'ut of order). Return 0 if OK, -1 if there is
+// not enough memory, the output failed, or a position does not
+// fit in a binary format (TRACE_MAX_POS). Once an operation
+// fails, the writer writes nothing else, and closing it returns
+// -1 too (the trace is incomplete).
+
+int trace_writer_open (stracewriter * W, FILE * pf, int format,
+                       unsigned totelem);
+int trace_write_op (stracewriter * W, char op, unsigned pos);
+int trace_writer_close (stracewriter * W, int sorted);
+
+#endif // _TRACE_H_
@@ -0,0 +1,108 @@
+/*
+    trace_cache.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "trace_cache.h"
+
+#define DEFAULT_CACHE_DIR ".trace_cache"
+
+// 64-bit FNV-1a hash of a string
+
+static unsigned long long hash_key (const char * key)
+{
+    unsigned long long h = 0xcbf29ce484222325ULL;
+
+    for (; *key; key++)
+    {
+        h ^= (unsigned char) *key;
+        h *= 0x100000001b3ULL;
+    }
+
+    return h;
+}
+
+// Read the trace through a pipe from gen_trace
+
+static int open_command (strace * T, const char * command)
+{
+    FILE * pipe;
+
+    pipe = popen (command, "r");
+
+    if (!pipe)
+        return -1;
+
+    if (trace_open_pipe(T,pipe)<0)
+    {
+        pclose (pipe);
+        trace_close (T);
+        return -1;
+    }
+
+    T->closepipe = 1;
+    return 0;
+}
+
+int trace_cache_open (strace * T, const char * algorithm,
+                      const char * initorder, unsigned numelem,
+                      unsigned seed, char * path, size_t pathsz)
+{
+    const char * dir;
+    char key[128], temp[FILENAME_MAX], command[2*FILENAME_MAX];
+    struct stat st;
+    int hit;
+
+    dir = getenv ("TRACE_CACHE_DIR");
+
+    if (!dir)
+        dir = DEFAULT_CACHE_DIR;
+
+    if (!*dir || (mkdir(dir,0777)<0 && errno!=EEXIST))
+    {
+        // No cache: straight from gen_trace
+        snprintf (path, pathsz, "./gen_trace -b -s %u %s %s %u",
+                  seed, algorithm, initorder, numelem);
+
+        return open_command(T,path)<0 ? -1 : 0;
+    }
+
+    // The traces are addressed by a hash of their parameters
+
+    snprintf (key, sizeof(key), "%s %s %u seed=%u version=%d",
+              algorithm, initorder, numelem, seed,
+              TRACE_CACHE_VERSION);
+
+    snprintf (path, pathsz, "%s/%s-%s-%u-%016llx.trz",
+              dir, algorithm, initorder, numelem, hash_key(key));
+
+    hit = stat(path,&st)==0;
+
+    if (!hit)
+    {
+        // Generate it in a temporary file and rename it only
+        // when complete, so that other processes sharing the
+        // cache never see it half written
+
+        snprintf (temp, sizeof(temp), "%s.%d.tmp",
+                  path, (int) getpid());
+
+        snprintf (command, sizeof(command),
+                  "./gen_trace -z -s %u %s %s %u > '%s'",
+                  seed, algorithm, initorder, numelem, temp);
+
+        if (system(command)!=0 || rename(temp,path)<0)
+        {
+            unlink (temp);
+            return -1;
+        }
+    }
+
+    return trace_open_file(T,path)<0 ? -1 : hit;
+}
@@ -0,0 +1,38 @@
+/*
+    trace_cache.h
+*/
+
+#ifndef _TRACE_CACHE_H_
+#define _TRACE_CACHE_H_
+
+#include <stddef.h>
+
+#include "trace.h"
+
+// gen_trace is deterministic: the same algorithm, initial
+// order, size and seed always give the same trace. So the
+// traces are kept in a cache on disc, compressed in blocks
+// (TRACE_BLOCKS), and only generated the first time they are
+// needed.
+//
+// The cache lives in the directory given by the environment
+// variable TRACE_CACHE_DIR (.trace_cache by default). Setting
+// it to an empty string disables the cache.
+
+// Version of the traces. Increment it whenever gen_trace or
+// the sorting algorithms change the traces they produce, so
+// that the old traces are not reused.
+
+#define TRACE_CACHE_VERSION 3
+
+// Open the trace for the given parameters, taking it from the
+// cache or generating it on a miss. If the cache can't be
+// used, the trace is read directly from gen_trace. The path of
+// the cached file (or the command run) is stored in 'path'.
+// Return 1 on a hit, 0 on a miss and -1 on error.
+
+int trace_cache_open (strace * T, const char * algorithm,
+                      const char * initorder, unsigned numelem,
+                      unsigned seed, char * path, size_t pathsz);
+
+#endif // _TRACE_CACHE_H_
@@ -0,0 +1,330 @@
+/*
+    trace_codec.c
+*/
+
+#include <string.h>
+
+#include "trace.h"
+#include "trace_codec.h"
+
+static unsigned get_word (const unsigned char * p)
+{
+    return p[0] | p[1]<<8 | p[2]<<16 | (unsigned)p[3]<<24;
+}
+
+static void put_word (unsigned char * p, unsigned w)
+{
+    p[0] = w;
+    p[1] = w>>8;
+    p[2] = w>>16;
+    p[3] = w>>24;
+}
+
+// Stage 1: operation codes packed 4 per byte, followed by the
+// delta-encoded positions as varints
+
+static size_t pack_ops (const unsigned * words, unsigned numops,
+                        unsigned char * raw)
+{
+    unsigned u, op, pos, z, prev[4] = { 0, 0, 0, 0 };
+    unsigned char * p;
+
+    memset (raw, 0, (numops+3)/4);
+    p = raw + (numops+3)/4;
+
+    for (u=0; u<numops; u++)
+    {
+        op = words[u] >> 30;
+        raw[u>>2] |= op << ((u&3)*2);
+
+        if (op==TRACE_OP_CMP)
+            continue;
+
+        // Zig-zag the difference with the previous position of
+        // the same kind, so that small negative deltas are
+        // small numbers too
+
+        pos = words[u] & TRACE_MAX_POS;
+        z = pos - prev[op];
+        z = (z<<1) ^ (unsigned)((int)z>>31);
+        prev[op] = pos;
+
+        while (z>=0x80)
+        {
+            *p++ = z | 0x80;
+            z >>= 7;
+        }
+
+        *p++ = z;
+    }
+
+    return p - raw;
+}
+
+static int unpack_ops (const unsigned char * raw, size_t rawsize,
+                       unsigned numops, unsigned * words)
+{
+    unsigned u, op, pos, z, shift, prev[4] = { 0, 0, 0, 0 };
+    const unsigned char * p, * end;
+
+    if (rawsize < (numops+3)/4)
+        return -1;
+
+    p = raw + (numops+3)/4;
+    end = raw + rawsize;
+
+    for (u=0; u<numops; u++)
+    {
+        op = (raw[u>>2] >> ((u&3)*2)) & 3;
+
+        if (op==TRACE_OP_CMP)
+        {
+            words[u] = TRACE_OP_CMP<<30;
+            continue;
+        }
+
+        for (z=shift=0; ; shift+=7)
+        {
+            if (p==end || shift>28)
+                return -1;
+
+            z |= (unsigned)(*p & 0x7f) << shift;
+
+            if (!(*p++ & 0x80))
+                break;
+        }
+
+        pos = prev[op] + ((z>>1) ^ -(z&1));
+        prev[op] = pos;
+        words[u] = op<<30 | (pos & TRACE_MAX_POS);
+    }
+
+    return p==end ? 0 : -1;
+}
+
+// Stage 2: LZ77 in the style of LZ4. The data are a series of
+// sequences, each one made of a token (4 bits for the number
+// of literals and 4 for the length of the match, minus 4), the
+// literals, the offset of the match (2 bytes) and the lengths
+// that didn't fit in the token (in bytes of 255 and a last one
+// lesser than that). The last sequence has only literals.
+
+#define LZ_MIN_MATCH   4
+#define LZ_HASH_BITS   14
+#define LZ_MAX_OFFSET  65535
+
+static unsigned char * put_length (unsigned char * p, size_t n)
+{
+    for (; n>=255; n-=255)
+        *p++ = 255;
+
+    *p++ = n;
+    return p;
+}
+
+static unsigned char * put_sequence (unsigned char * p,
+                                     const unsigned char * lit,
+                                     size_t numlit,
+                                     unsigned offset, size_t len)
+{
+    *p++ = (numlit<15 ? numlit : 15) << 4 |
+           (len ? (len-LZ_MIN_MATCH<15 ? len-LZ_MIN_MATCH : 15) : 0);
+
+    if (numlit>=15)
+        p = put_length (p, numlit-15);
+
+    memcpy (p, lit, numlit);
+    p += numlit;
+
+    if (len)
+    {
+        *p++ = offset;
+        *p++ = offset>>8;
+
+        if (len-LZ_MIN_MATCH>=15)
+            p = put_length (p, len-LZ_MIN_MATCH-15);
+    }
+
+    return p;
+}
+
+static size_t lz_compress (const unsigned char * src, size_t n,
+                           unsigned char * dst)
+{
+    int table[1<<LZ_HASH_BITS];
+    size_t ip, anchor, ref, len;
+    unsigned seq, h;
+    unsigned char * p = dst;
+
+    memset (table, -1, sizeof(table));
+
+    for (ip=anchor=0; ip+LZ_MIN_MATCH<=n; )
+    {
+        memcpy (&seq, src+ip, 4);
+        h = (seq*2654435761U) >> (32-LZ_HASH_BITS);
+        ref = table[h];
+        table[h] = ip;
+
+        if (ref==(size_t)-1 || ip-ref>LZ_MAX_OFFSET ||
+            memcmp(src+ref,src+ip,LZ_MIN_MATCH))
+        {
+            ip ++;
+            continue;
+        }
+
+        for (len=LZ_MIN_MATCH; ip+len<n && src[ref+len]==src[ip+len];
+             len++)
+            ;
+
+        p = put_sequence (p, src+anchor, ip-anchor, ip-ref, len);
+        ip += len;
+        anchor = ip;
+    }
+
+    p = put_sequence (p, src+anchor, n-anchor, 0, 0);
+
+    return p - dst;
+}
+
+static int get_length (const unsigned char ** pp,
+                       const unsigned char * end, size_t * n)
+{
+    const unsigned char * p = *pp;
+
+    do
+    {
+        if (p==end)
+            return -1;
+
+        *n += *p;
+    }
+    while (*p++==255);
+
+    *pp = p;
+    return 0;
+}
+
+static long lz_decompress (const unsigned char * src, size_t n,
+                           unsigned char * dst, size_t cap)
+{
+    const unsigned char * p = src, * end = src+n;
+    unsigned char * q = dst, * qend = dst+cap;
+    size_t numlit, len;
+    unsigned offset;
+    unsigned char token;
+
+    while (p<end)
+    {
+        token = *p++;
+        numlit = token >> 4;
+
+        if (numlit==15 && get_length(&p,end,&numlit)<0)
+            return -1;
+
+        if (numlit > (size_t)(end-p) || numlit > (size_t)(qend-q))
+            return -1;
+
+        memcpy (q, p, numlit);
+        p += numlit;
+        q += numlit;
+
+        if (p==end)             // Last sequence: no match
+            break;
+
+        if (end-p < 2)
+            return -1;
+
+        offset = p[0] | p[1]<<8;
+        p += 2;
+        len = (token & 15);
+
+        if (len==15 && get_length(&p,end,&len)<0)
+            return -1;
+
+        len += LZ_MIN_MATCH;
+
+        if (!offset || offset > (size_t)(q-dst) ||
+            len > (size_t)(qend-q))
+            return -1;
+
+        // Byte by byte: the match may overlap what it copies
+        for (; len; len--, q++)
+            *q = q[-(long)offset];
+    }
+
+    return q - dst;
+}
+
+// Blocks
+
+size_t tz_encode_block (const unsigned * words, unsigned numops,
+                        unsigned char * block,
+                        unsigned char * scratch)
+{
+    size_t rawsize, size;
+
+    rawsize = pack_ops (words, numops, scratch);
+    size = lz_compress (scratch, rawsize, block+TZ_HEADER_SIZE);
+
+    if (size >= rawsize)     // Not worth it: store as is
+    {
+        memcpy (block+TZ_HEADER_SIZE, scratch, rawsize);
+        size = rawsize;
+    }
+
+    put_word (block, rawsize);
+    put_word (block+4, size);
+    put_word (block+8, numops);
+
+    return TZ_HEADER_SIZE + size;
+}
+
+size_t tz_block_size (const unsigned char * header)
+{
+    size_t rawsize, size;
+
+    rawsize = get_word (header);
+    size = get_word (header+4);
+
+    if (rawsize>TZ_MAX_RAW || size>rawsize ||
+        get_word(header+8)>TZ_BLOCK_OPS)
+        return 0;
+
+    return TZ_HEADER_SIZE + size;
+}
+
+int tz_decode_block (const unsigned char * block, size_t avail,
+                     unsigned * words, unsigned char * scratch,
+                     size_t * psize)
+{
+    size_t rawsize, size;
+    unsigned numops;
+    const unsigned char * raw;
+
+    if (avail<TZ_HEADER_SIZE)
+        return -1;
+
+    size = tz_block_size (block);
+
+    if (!size || size>avail)
+        return -1;
+
+    rawsize = get_word (block);
+    numops = get_word (block+8);
+    raw = block + TZ_HEADER_SIZE;
+
+    if (size-TZ_HEADER_SIZE < rawsize)
+    {
+        if (lz_decompress(raw, size-TZ_HEADER_SIZE,
+                          scratch, rawsize) != (long)rawsize)
+            return -1;
+
+        raw = scratch;
+    }
+
+    if (unpack_ops(raw,rawsize,numops,words)<0)
+        return -1;
+
+    *psize = size;
+    return numops;
+}
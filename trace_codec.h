@@ -0,0 +1,65 @@
+/*
+    trace_codec.h
+*/
+
+#ifndef _TRACE_CODEC_H_
+#define _TRACE_CODEC_H_
+
+#include <stddef.h>
+
+// Codec of the blocks of the compressed trace format.
+//
+// A block holds up to TZ_BLOCK_OPS operations, given as the
+// 32-bit words of the binary format (2 bits of operation and
+// 30 of position). They are encoded in two stages:
+//
+// 1. The operation codes are packed 4 per byte, and then the
+//    positions of the reads, writes and end marks follow as
+//    varints (7 bits per byte, LEB128). Each position is
+//    delta-encoded against the previous one of the same kind
+//    (reads against reads, writes against writes) and
+//    zig-zagged, so the usual sequential sweeps of the sorting
+//    algorithms take a single byte per operation.
+//
+// 2. The result is compressed with a small LZ77 codec in the
+//    style of LZ4 (byte-aligned sequences of literals and
+//    matches within a 64 KiB window), which catches the
+//    repetitive patterns of the inner loops. If that doesn't
+//    make it smaller, the block is stored as is.
+//
+// A block starts with a header of 3 little endian words: the
+// size of the stage 1 data, the size of the stored data and
+// the number of operations. Blocks don't depend on each other,
+// so they can be decoded in any order, or in parallel.
+
+#define TZ_BLOCK_OPS     65536
+#define TZ_HEADER_SIZE   12
+
+// Maximum sizes of the stage 1 data and of a whole block
+#define TZ_MAX_RAW       (TZ_BLOCK_OPS/4 + 5*TZ_BLOCK_OPS)
+#define TZ_MAX_BLOCK     (TZ_HEADER_SIZE + TZ_MAX_RAW + \
+                          TZ_MAX_RAW/255 + 16)
+
+// Encode 'numops' words (1..TZ_BLOCK_OPS) in 'block', which
+// must hold TZ_MAX_BLOCK bytes. 'scratch' must hold TZ_MAX_RAW
+// bytes. Return the size of the block.
+
+size_t tz_encode_block (const unsigned * words, unsigned numops,
+                        unsigned char * block,
+                        unsigned char * scratch);
+
+// Decode the block at 'block', of which 'avail' bytes can be
+// read, into 'words' (TZ_BLOCK_OPS of them). 'scratch' must
+// hold TZ_MAX_RAW bytes. Return the number of operations, or
+// -1 if the block is malformed. The size of the block is
+// stored in *psize.
+
+int tz_decode_block (const unsigned char * block, size_t avail,
+                     unsigned * words, unsigned char * scratch,
+                     size_t * psize);
+
+// Size of a block, from its header (0 if it's malformed)
+
+size_t tz_block_size (const unsigned char * header);
+
+#endif // _TRACE_CODEC_H_
@@ -0,0 +1,527 @@
+/*
+    workloads.c
+*/
+
+#include <stdlib.h>
+#include "workloads.h"
+
+// Matrix multiply: C = A x B
+//     Layout:                A from 0, B from n*n and C from
+//                            2*n*n, all of them by rows; with
+//                            param 1, B by columns (naive only)
+//     Operations:            O(N*N*N) reads, O(N*N) writes
+//     Other considerations:  The naive version goes through a
+//                            column of B for each element of C,
+//                            so B does not stay in memory unless
+//                            it's stored by columns. The blocked
+//                            version multiplies blocks of
+//                            param x param elements, and the
+//                            blocks of A, B and C in use fit in
+//                            a few pages; it reads and writes C
+//                            once for each block of A.
+
+static unsigned pos_b (unsigned n, unsigned bycols,
+                       unsigned k, unsigned j)
+{
+    return n*n + (bycols ? j*n+k : k*n+j);
+}
+
+unsigned matmul_size (unsigned n, unsigned param)
+{
+    return 3*n*n;
+}
+
+void matmul_init (thing M[], unsigned n, unsigned param,
+                  const thing order[])
+{
+    unsigned u;
+
+    // Small integers, so that the sums are exact in any order
+    for (u=0; u<2*n*n; u++)
+        M[u] = ((unsigned) order[u%n] + u/n) % 10;
+
+    for (; u<3*n*n; u++)
+        M[u] = 0;
+}
+
+unsigned matmul_naive (void * p, unsigned n, unsigned bycols,
+                       function_lesser_than * plesserthan,
+                       function_read * pread,
+                       function_write * pwrite)
+{
+    unsigned i, j, k, iter;
+    thing sum;
+
+    for (i=0, iter=0; i<n; i++)
+        for (j=0; j<n; j++)
+        {
+            for (sum=0, k=0; k<n; k++, iter++)
+                sum += pread (p, i*n+k) *
+                       pread (p, pos_b(n,bycols,k,j));
+
+            pwrite (p, 2*n*n + i*n+j, sum);
+        }
+
+    return iter;
+}
+
+unsigned matmul_blocked (void * p, unsigned n, unsigned side,
+                         function_lesser_than * plesserthan,
+                         function_read * pread,
+                         function_write * pwrite)
+{
+    unsigned ii, jj, kk, i, j, k, iter;
+    unsigned iend, jend, kend;
+    thing sum;
+
+    for (ii=0, iter=0; ii<n; ii+=side)
+        for (jj=0; jj<n; jj+=side)
+            for (kk=0; kk<n; kk+=side)
+            {
+                iend = ii+side<n ? ii+side : n;
+                jend = jj+side<n ? jj+side : n;
+                kend = kk+side<n ? kk+side : n;
+
+                for (i=ii; i<iend; i++)
+                    for (j=jj; j<jend; j++)
+                    {
+                        // The sum of the previous blocks
+                        sum = kk ? pread (p, 2*n*n + i*n+j) : 0;
+
+                        for (k=kk; k<kend; k++, iter++)
+                            sum += pread (p, i*n+k) *
+                                   pread (p, pos_b(n,0,k,j));
+
+                        pwrite (p, 2*n*n + i*n+j, sum);
+                    }
+            }
+
+    return iter;
+}
+
+static int check_product (const thing M[], unsigned n,
+                          unsigned bycols)
+{
+    unsigned i, j, k;
+    thing sum;
+
+    for (i=0; i<n; i++)
+        for (j=0; j<n; j++)
+        {
+            for (sum=0, k=0; k<n; k++)
+                sum += M[i*n+k] * M[pos_b(n,bycols,k,j)];
+
+            if (M[2*n*n + i*n+j] != sum)
+                return 0;
+        }
+
+    return 1;
+}
+
+int matmul_naive_check (const thing M[], unsigned n,
+                        unsigned bycols)
+{
+    return check_product (M, n, bycols);
+}
+
+int matmul_blocked_check (const thing M[], unsigned n,
+                          unsigned side)
+{
+    return check_product (M, n, 0);
+}
+
+// Hash join: R join S on their keys
+//     Layout:                the keys of R from 0 and those of S
+//                            from n; then the hash table, whose
+//                            slots are pairs (key, row of R),
+//                            and then the row of R that matches
+//                            each row of S (-1 = none)
+//     Operations:            O(N) on average
+//     Other considerations:  The build phase inserts R in the
+//                            table, with open addressing (linear
+//                            probing); its size is the power of
+//                            2 that keeps the load under param
+//                            percent. The probe phase looks up
+//                            every key of S. Both go all over the
+//                            table, which is the working set.
+//                            R has the keys 0..n-1 and S the even
+//                            numbers up to 2n, so half of S
+//                            matches; both in the initial order.
+
+static unsigned hash_bits (unsigned n, unsigned load)
+{
+    unsigned bits = 1;
+
+    while ((1ULL<<bits)*load < n*100ULL)
+        bits ++;
+
+    return bits;
+}
+
+// Fibonacci hashing: the upper bits of the key times 2^32/phi
+
+static unsigned hash_key (thing key, unsigned bits)
+{
+    return ((unsigned) key * 2654435769U) >> (32-bits);
+}
+
+unsigned hash_join_size (unsigned n, unsigned load)
+{
+    return 3*n + 2*(1U<<hash_bits(n,load));
+}
+
+void hash_join_init (thing H[], unsigned n, unsigned load,
+                     const thing order[])
+{
+    unsigned u, slots = 1U<<hash_bits(n,load);
+
+    for (u=0; u<n; u++)
+    {
+        H[u] = order[u];
+        H[n+u] = 2*order[u];
+    }
+
+    for (u=0; u<2*slots; u++)      // All empty
+        H[2*n+u] = -1;
+
+    for (u=0; u<n; u++)
+        H[2*n+2*slots+u] = 0;
+}
+
+unsigned hash_join (void * p, unsigned n, unsigned load,
+                    function_lesser_than * plesserthan,
+                    function_read * pread,
+                    function_write * pwrite)
+{
+    unsigned bits = hash_bits (n, load), mask = (1U<<bits)-1;
+    unsigned table = 2*n, output = 2*n + 2*(mask+1);
+    unsigned r, s, h, iter;
+    thing key, slot, match;
+
+    // Build
+
+    for (r=0, iter=0; r<n; r++)
+    {
+        key = pread (p, r);
+
+        for (h=hash_key(key,bits); ; h=(h+1)&mask, iter++)
+            if (plesserthan(p,pread(p,table+2*h),0))  // Empty
+                break;
+
+        pwrite (p, table+2*h, key);
+        pwrite (p, table+2*h+1, r);
+    }
+
+    // Probe
+
+    for (s=0; s<n; s++)
+    {
+        key = pread (p, n+s);
+        match = -1;
+
+        for (h=hash_key(key,bits); ; h=(h+1)&mask, iter++)
+        {
+            slot = pread (p, table+2*h);
+
+            if (plesserthan(p,slot,0))       // Empty: no match
+                break;
+
+            if (!plesserthan(p,slot,key) && !plesserthan(p,key,slot))
+            {
+                match = pread (p, table+2*h+1);
+                break;
+            }
+        }
+
+        pwrite (p, output+s, match);
+    }
+
+    return iter;
+}
+
+int hash_join_check (const thing H[], unsigned n, unsigned load)
+{
+    unsigned output = 2*n + 2*(1U<<hash_bits(n,load));
+    unsigned s;
+    thing key, match;
+
+    for (s=0; s<n; s++)
+    {
+        key = H[n+s];
+        match = H[output+s];
+
+        if (key<n ? match<0 || match>=n || H[(unsigned)match]!=key
+                  : match!=-1)
+            return 0;
+    }
+
+    return 1;
+}
+
+// Lookups in a B+-tree
+//     Layout:                the keys to look up from 0; then the
+//                            nodes of the tree, level by level
+//                            from the root, and from left to
+//                            right; then the position of each key
+//                            in the leaves (-1 = not found)
+//     Operations:            O(N*log(N)), or rather
+//                            O(N*param*log_param(N))
+//     Other considerations:  The tree is built beforehand, full:
+//                            the leaves hold the keys 0, 2,
+//                            4... 2n-2, and each key above them is
+//                            the first one of a node of the level
+//                            below. The nodes are scanned from
+//                            left to right. The keys looked up are
+//                            0..n-1 in the initial order, so half
+//                            of them are found. The levels near
+//                            the root are used by every lookup.
+
+#define BTREE_LEVELS 32
+
+// Keys of each level, from the leaves (0) up to the root, and
+// where each level begins; return the number of levels
+
+static int btree_levels (unsigned n, unsigned fanout,
+                         unsigned len[], unsigned first[])
+{
+    int levels, l;
+
+    len[0] = n;
+
+    for (levels=1; len[levels-1]>fanout; levels++)
+        len[levels] = (len[levels-1]+fanout-1) / fanout;
+
+    first[levels-1] = n;
+
+    for (l=levels-1; l>0; l--)
+        first[l-1] = first[l] + len[l];
+
+    return levels;
+}
+
+unsigned btree_size (unsigned n, unsigned fanout)
+{
+    unsigned len[BTREE_LEVELS], first[BTREE_LEVELS];
+
+    btree_levels (n, fanout, len, first);
+
+    return first[0] + 2*n;
+}
+
+void btree_init (thing B[], unsigned n, unsigned fanout,
+                 const thing order[])
+{
+    unsigned len[BTREE_LEVELS], first[BTREE_LEVELS], u;
+    int levels, l;
+
+    levels = btree_levels (n, fanout, len, first);
+
+    for (u=0; u<n; u++)
+        B[u] = order[u];
+
+    for (u=0; u<n; u++)
+        B[first[0]+u] = 2*u;
+
+    for (l=1; l<levels; l++)
+        for (u=0; u<len[l]; u++)
+            B[first[l]+u] = B[first[l-1]+u*fanout];
+
+    for (u=0; u<n; u++)
+        B[first[0]+n+u] = 0;
+}
+
+unsigned btree_lookup (void * p, unsigned n, unsigned fanout,
+                       function_lesser_than * plesserthan,
+                       function_read * pread,
+                       function_write * pwrite)
+{
+    unsigned len[BTREE_LEVELS], first[BTREE_LEVELS];
+    unsigned u, node, q, end, iter;
+    int levels, l;
+    thing key, k;
+
+    levels = btree_levels (n, fanout, len, first);
+
+    for (u=0, iter=0; u<n; u++)
+    {
+        key = pread (p, u);
+
+        for (l=levels-1, node=0; ; l--)
+        {
+            q = first[l] + node*fanout;
+            end = first[l] + len[l];
+
+            if (q+fanout<end)
+                end = q+fanout;
+
+            // The last key of the node not greater than 'key'
+            for (q++; q<end && !plesserthan(p,key,pread(p,q)); q++)
+                iter ++;
+
+            q --;
+
+            if (!l)
+                break;
+
+            node = q - first[l];     // Its node in the level below
+        }
+
+        k = pread (p, q);
+
+        pwrite (p, first[0]+n+u,
+                !plesserthan(p,k,key) && !plesserthan(p,key,k) ?
+                (thing) (q-first[0]) : -1);
+    }
+
+    return iter;
+}
+
+int btree_check (const thing B[], unsigned n, unsigned fanout)
+{
+    unsigned len[BTREE_LEVELS], first[BTREE_LEVELS], u, key;
+
+    btree_levels (n, fanout, len, first);
+
+    for (u=0; u<n; u++)
+    {
+        key = B[u];
+
+        if (B[first[0]+n+u] != (key%2 ? -1 : (thing) (key/2)))
+            return 0;
+    }
+
+    return 1;
+}
+
+// Breadth-first search from vertex 0
+//     Layout:                the graph in compressed sparse row
+//                            format: the first edge of each vertex
+//                            (n+1 offsets) from 0, then the
+//                            destinations of the edges; then the
+//                            distance of each vertex from 0 (-1 =
+//                            not reached yet) and the queue of
+//                            vertices to visit
+//     Operations:            O(N*param)
+//     Other considerations:  Every vertex has param edges: to
+//                            the next and previous vertices of a
+//                            ring, so that all of them are
+//                            reached, and to param-2 vertices at
+//                            random (always the same ones). The
+//                            initial order numbers the vertices
+//                            of the ring: in ASC or DES order the
+//                            neighbours in the ring are also
+//                            neighbours in memory; in RAN order
+//                            they are anywhere.
+
+unsigned bfs_size (unsigned n, unsigned degree)
+{
+    return n+1 + n*degree + 2*n;
+}
+
+void bfs_init (thing G[], unsigned n, unsigned degree,
+               const thing order[])
+{
+    unsigned v, d, e, x = 2463534242U;
+    unsigned edges = n+1;
+
+    for (v=0; v<n; v++)
+    {
+        // Edges of vertex v of the ring, numbered order[v]
+        e = (unsigned) order[v] * degree;
+        G[edges+e] = order[(v+1)%n];
+        G[edges+e+1] = order[(v+n-1)%n];
+
+        for (d=2; d<degree; d++)
+        {
+            x ^= x<<13;      // Xorshift: the same graph always
+            x ^= x>>17;
+            x ^= x<<5;
+            G[edges+e+d] = order[x%n];
+        }
+    }
+
+    for (v=0; v<=n; v++)
+        G[v] = v*degree;
+
+    for (v=0; v<n; v++)
+    {
+        G[edges+n*degree+v] = -1;
+        G[edges+n*degree+n+v] = 0;
+    }
+}
+
+unsigned bfs (void * p, unsigned n, unsigned degree,
+              function_lesser_than * plesserthan,
+              function_read * pread,
+              function_write * pwrite)
+{
+    unsigned edges = n+1, dist = edges + n*degree, queue = dist+n;
+    unsigned head, tail, e, end, v, w, iter;
+    thing d;
+
+    pwrite (p, dist, 0);
+    pwrite (p, queue, 0);
+
+    for (head=0, tail=1, iter=0; head<tail; head++)
+    {
+        v = pread (p, queue+head);
+        d = pread (p, dist+v);
+        end = pread (p, v+1);
+
+        for (e=pread(p,v); e<end; e++, iter++)
+        {
+            w = pread (p, edges+e);
+
+            if (plesserthan(p,pread(p,dist+w),0))   // Not reached
+            {
+                pwrite (p, dist+w, d+1);
+                pwrite (p, queue+tail++, w);
+            }
+        }
+    }
+
+    return iter;
+}
+
+int bfs_check (const thing G[], unsigned n, unsigned degree)
+{
+    unsigned edges = n+1, dist = edges + n*degree;
+    unsigned * queue, * seen, head, tail, e, v, w;
+    int ok = 1;
+
+    queue = (unsigned*) malloc (n*sizeof(unsigned));
+    seen = (unsigned*) calloc (n, sizeof(unsigned));
+
+    if (!queue || !seen)
+        ok = 0;
+    else
+    {
+        queue[0] = 0;
+        seen[0] = 1;
+
+        // Every vertex, in the order of the search, must be at
+        // one more than its parent
+        for (head=0, tail=1; ok && head<tail; head++)
+        {
+            v = queue[head];
+
+            for (e=G[v]; e<G[v+1]; e++)
+            {
+                w = G[edges+e];
+
+                if (!seen[w])
+                {
+                    seen[w] = 1;
+                    queue[tail++] = w;
+                    ok = ok && G[dist+w] == G[dist+v]+1;
+                }
+            }
+        }
+
+        ok = ok && tail==n && G[dist]==0;
+    }
+
+    free (queue);
+    free (seen);
+    return ok;
+}
@@ -0,0 +1,71 @@
+/*
+    workloads.h
+*/
+
+#ifndef _WORKLOADS_H_
+#define _WORKLOADS_H_
+
+#include "sort.h"
+
+// Workloads other than sorting, for gen_trace. Like the sorting
+// algorithms, they access the data only through the 'pread',
+// 'pwrite' and 'plesserthan' functions, so that their traces
+// have the same format. Each one has a size (of the matrices,
+// tables, tree or graph) and a parameter (of the layout, or of
+// the size of the blocks, nodes...), and comes with functions
+// that give the number of elements it needs, prepare them from
+// a permutation of 0..size-1 in the initial order ('order'),
+// and check the result afterwards (1 = right, 0 = wrong; the
+// trace ends as "sorted" only if it's right).
+
+typedef unsigned function_workload_size (unsigned size,
+                                         unsigned param);
+
+typedef void function_workload_init (thing A[], unsigned size,
+                                     unsigned param,
+                                     const thing order[]);
+
+typedef unsigned function_workload (void *, unsigned size,
+                                    unsigned param,
+                                    function_lesser_than *plesserthan,
+                                    function_read *pread,
+                                    function_write *pwrite);
+
+typedef int function_workload_check (const thing A[],
+                                     unsigned size,
+                                     unsigned param);
+
+// Matrix multiply of size x size matrices, naive (param = 0 if
+// B is stored by rows, 1 by columns) or blocked (param = side
+// of the blocks)
+
+function_workload_size matmul_size;
+function_workload_init matmul_init;
+function_workload matmul_naive, matmul_blocked;
+function_workload_check matmul_naive_check, matmul_blocked_check;
+
+// Hash join of two relations of size rows (param = maximum load
+// of the hash table, in percent)
+
+function_workload_size hash_join_size;
+function_workload_init hash_join_init;
+function_workload hash_join;
+function_workload_check hash_join_check;
+
+// Lookups of size keys in a B+-tree of size keys (param = keys
+// per node)
+
+function_workload_size btree_size;
+function_workload_init btree_init;
+function_workload btree_lookup;
+function_workload_check btree_check;
+
+// Breadth-first search of a graph of size vertices (param =
+// edges per vertex)
+
+function_workload_size bfs_size;
+function_workload_init bfs_init;
+function_workload bfs;
+function_workload_check bfs_check;
+
+#endif // _WORKLOADS_H_
@@ -0,0 +1,44 @@
+/*
+    xoshiro.c
+*/
+
+#include "xoshiro.h"
+
+#define ROTL(x,k) ((x)<<(k) | (x)>>(64-(k)))
+
+void xoshiro_seed (sxoshiro * X, unsigned long long seed)
+{
+    unsigned long long z;
+    int i;
+
+    for (i=0; i<4; i++)
+    {
+        seed += 0x9e3779b97f4a7c15ULL;
+        z = seed;
+        z = (z ^ (z>>30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z>>27)) * 0x94d049bb133111ebULL;
+        X->s[i] = z ^ (z>>31);
+    }
+}
+
+unsigned long long xoshiro_next (sxoshiro * X)
+{
+    unsigned long long * s = X->s;
+    unsigned long long result = ROTL(s[1]*5, 7) * 9;
+    unsigned long long t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = ROTL(s[3], 45);
+
+    return result;
+}
+
+unsigned xoshiro_below (sxoshiro * X, unsigned n)
+{
+    // The upper 32 bits, scaled to 0..n-1
+    return (unsigned) (((xoshiro_next(X)>>32) * n) >> 32);
+}
@@ -0,0 +1,34 @@
+/*
+    xoshiro.h
+*/
+
+#ifndef _XOSHIRO_H_
+#define _XOSHIRO_H_
+
+// Random numbers with xoshiro256** (Blackman and Vigna): fast,
+// with a period of 2^256-1, and each generator keeps its own
+// state, so that several of them can be used at the same time
+// (in different threads, or for different purposes) without
+// disturbing each other, unlike rand().
+
+typedef struct
+{
+    unsigned long long s[4];
+}
+sxoshiro;
+
+// Start a generator from a seed (expanded with splitmix64, so
+// that close seeds give unrelated sequences)
+
+void xoshiro_seed (sxoshiro * X, unsigned long long seed);
+
+// Next 64 random bits
+
+unsigned long long xoshiro_next (sxoshiro * X);
+
+// Random number in 0..n-1 (n>0), by multiplying instead of
+// dividing (Lemire)
+
+unsigned xoshiro_below (sxoshiro * X, unsigned n);
+
+#endif // _XOSHIRO_H_